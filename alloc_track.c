@@ -0,0 +1,196 @@
+#include <stdint.h>
+#include "alloc_track.h"
+
+// We don't put anything in front of the blocks we hand out. Instead every
+// block we gave out goes into a small hash table (pointer -> size). That way
+// free() can tell our blocks apart from memory that libc allocated by itself
+// (getline, strndup, asprintf, realpath, scandir, ...), which the interpreter
+// is allowed to free() too. Those just go to the real free() and don't count.
+//
+// The table itself uses the real malloc, this file isn't built with
+// ALLOC_TRACK_WRAP.
+
+typedef struct {
+    void *ptr;       // NULL = empty slot
+    size_t size;
+} TrackedBlock;
+
+static TrackedBlock *table = NULL;
+static size_t table_cap = 0;    // always a power of two
+static size_t table_used = 0;
+
+static long live_bytes = 0;
+static long peak_bytes = 0;
+static long live_blocks = 0;
+static long phase_count[ALLOC_PHASE_COUNT];
+static long phase_bytes[ALLOC_PHASE_COUNT];
+static AllocPhase current_phase = ALLOC_PHASE_OTHER;
+
+static const char *phase_names[ALLOC_PHASE_COUNT] = {
+    "other", "parse", "execute", "teardown"
+};
+
+static size_t home_slot(const void *ptr) {
+    uint64_t h = (uint64_t)(uintptr_t)ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & (table_cap - 1);
+}
+
+// Returns the slot holding ptr, or the empty slot where it would go
+static size_t find_slot(const void *ptr) {
+    size_t i = home_slot(ptr);
+    while (table[i].ptr != NULL && table[i].ptr != ptr) {
+        i = (i + 1) & (table_cap - 1);
+    }
+    return i;
+}
+
+static int table_grow(void) {
+    size_t new_cap = table_cap ? table_cap * 2 : 1024;
+    TrackedBlock *new_table = calloc(new_cap, sizeof(TrackedBlock));
+    if (!new_table) return 0;
+
+    TrackedBlock *old = table;
+    size_t old_cap = table_cap;
+    table = new_table;
+    table_cap = new_cap;
+    for (size_t k = 0; k < old_cap; k++) {
+        if (old[k].ptr != NULL) table[find_slot(old[k].ptr)] = old[k];
+    }
+    free(old);
+    return 1;
+}
+
+// Takes slot i out and moves later entries of the same run back, so lookups
+// never stop early at the hole (no "deleted" markers needed)
+static void table_remove_at(size_t i) {
+    size_t mask = table_cap - 1;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (table[j].ptr == NULL) break;
+        size_t home = home_slot(table[j].ptr);
+        // table[j] may fill the hole unless its home is between the hole and j
+        int home_in_between = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!home_in_between) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].ptr = NULL;
+    table_used--;
+}
+
+// Where ptr is in the table, or -1 if it isn't one of ours
+static long table_lookup(const void *ptr) {
+    if (table_used == 0) return -1;
+    size_t i = find_slot(ptr);
+    return table[i].ptr != NULL ? (long)i : -1;
+}
+
+static void track_forget_at(long slot) {
+    if (slot < 0) return;
+    live_bytes -= (long)table[slot].size;
+    live_blocks--;
+    table_remove_at((size_t)slot);
+}
+
+static void *track_new_block(void *ptr, size_t size) {
+    if (table_used + 1 > table_cap / 2 && !table_grow()) {
+        // only when we're out of memory anyway: the block is fine, it just isn't counted
+        return ptr;
+    }
+    size_t i = find_slot(ptr);
+    if (table[i].ptr == ptr) {
+        // libc freed or moved one of our blocks behind our back (e.g. getline
+        // growing a buffer we gave out) and now handed the address out again
+        live_bytes -= (long)table[i].size;
+        live_blocks--;
+    } else {
+        table[i].ptr = ptr;
+        table_used++;
+    }
+    table[i].size = size;
+
+    live_bytes += (long)size;
+    live_blocks++;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+    phase_count[current_phase]++;
+    phase_bytes[current_phase] += (long)size;
+    return ptr;
+}
+
+void *alloc_track_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) return NULL;
+    return track_new_block(ptr, size);
+}
+
+void *alloc_track_calloc(size_t count, size_t size) {
+    void *ptr = calloc(count, size);
+    if (!ptr) return NULL;
+    return track_new_block(ptr, count * size);   // calloc already checked for overflow
+}
+
+void *alloc_track_realloc(void *ptr, size_t size) {
+    if (ptr == NULL) return alloc_track_malloc(size);
+    if (size == 0) {
+        alloc_track_free(ptr);
+        return NULL;
+    }
+
+    // look it up first, after realloc() the old pointer mustn't be used any more
+    long slot = table_lookup(ptr);
+    void *moved = realloc(ptr, size);
+    if (!moved) return NULL;   // the old block is still there, nothing changed
+
+    // counts as giving back the old block and getting a new one
+    // (a block libc made that we now resize becomes one of ours)
+    track_forget_at(slot);
+    return track_new_block(moved, size);
+}
+
+void alloc_track_free(void *ptr) {
+    if (ptr == NULL) return;
+    track_forget_at(table_lookup(ptr));
+    free(ptr);
+}
+
+char *alloc_track_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *copy = alloc_track_malloc(len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+void alloc_track_set_phase(AllocPhase phase) {
+    if ((int)phase >= 0 && phase < ALLOC_PHASE_COUNT) current_phase = phase;
+}
+
+void alloc_track_reset_peak(void) {
+    peak_bytes = live_bytes;
+}
+
+long alloc_track_live_bytes(void) { return live_bytes; }
+long alloc_track_peak_bytes(void) { return peak_bytes; }
+long alloc_track_live_blocks(void) { return live_blocks; }
+
+long alloc_track_count(AllocPhase phase) {
+    return ((int)phase >= 0 && phase < ALLOC_PHASE_COUNT) ? phase_count[phase] : 0;
+}
+
+long alloc_track_bytes(AllocPhase phase) {
+    return ((int)phase >= 0 && phase < ALLOC_PHASE_COUNT) ? phase_bytes[phase] : 0;
+}
+
+void alloc_track_report(FILE *out) {
+    fprintf(out, "  Heap use by phase:\n");
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+        fprintf(out, "    %-9s %8ld allocs %10ld bytes\n",
+                phase_names[p], phase_count[p], phase_bytes[p]);
+    }
+    fprintf(out, "  Peak live bytes: %ld\n", peak_bytes);
+    fprintf(out, "  Still live:      %ld bytes in %ld blocks\n", live_bytes, live_blocks);
+}
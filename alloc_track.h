@@ -0,0 +1,63 @@
+#ifndef ALLOC_TRACK_H
+#define ALLOC_TRACK_H
+
+// Counts every malloc/calloc/realloc/free the interpreter does, so we can
+// see how much heap a program uses in each phase and whether anything is
+// still hanging around after free_list().
+//
+// The Makefile (BUILD=track) compiles memory.c, parser.c, executor.c and
+// errors.c with "-include alloc_track.h -DALLOC_TRACK_WRAP", which swaps
+// their malloc & co for the counting versions below. Nothing in those files
+// has to change. The tests and tools just include this header (without
+// ALLOC_TRACK_WRAP, so their own mallocs don't get counted) and use the
+// alloc_track_* functions, only when ALLOC_TRACK is defined.
+//
+// free()ing memory that libc handed out by itself (getline, strndup, ...) is
+// fine: it isn't one of ours, so it just gets freed and isn't counted. The
+// one thing we can't see is libc growing one of OUR blocks behind our back
+// (getline on a buffer you malloc'd); the old size then shows up as a leak.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    ALLOC_PHASE_OTHER,     // memory_init() and anything we didn't label
+    ALLOC_PHASE_PARSE,
+    ALLOC_PHASE_EXECUTE,
+    ALLOC_PHASE_TEARDOWN,  // free_list()
+    ALLOC_PHASE_COUNT
+} AllocPhase;
+
+void *alloc_track_malloc(size_t size);
+void *alloc_track_calloc(size_t count, size_t size);
+void *alloc_track_realloc(void *ptr, size_t size);
+void alloc_track_free(void *ptr);
+char *alloc_track_strdup(const char *s);
+
+// Which phase new allocations get counted under
+void alloc_track_set_phase(AllocPhase phase);
+
+// Starts a new peak from whatever is live right now (e.g. per program)
+void alloc_track_reset_peak(void);
+
+long alloc_track_live_bytes(void);        // asked for and not freed yet
+long alloc_track_peak_bytes(void);        // most live bytes at any point
+long alloc_track_live_blocks(void);
+long alloc_track_count(AllocPhase phase); // malloc/calloc/realloc calls in that phase
+long alloc_track_bytes(AllocPhase phase); // bytes asked for in that phase
+
+// Prints a small table of everything above
+void alloc_track_report(FILE *out);
+
+// Only the interpreter files get their calls swapped
+#ifdef ALLOC_TRACK_WRAP
+#undef strdup
+#define malloc(size) alloc_track_malloc(size)
+#define calloc(count, size) alloc_track_calloc(count, size)
+#define realloc(ptr, size) alloc_track_realloc(ptr, size)
+#define free(ptr) alloc_track_free(ptr)
+#define strdup(s) alloc_track_strdup(s)
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "memory.h"
+#include "parser.h"
+#include "executor.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Fuzz harness: throws mutated program text at parse() and then runs
+// every command it gave back with execute(). If the interpreter crashes,
+// reads out of bounds or does something undefined, the sanitizers catch it.
+//
+// (the build lines below are split over two lines to fit, type them as one)
+//
+// libFuzzer (clang):
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined -DFUZZ_NO_MAIN -o fuzz_interpreter
+//       fuzz_interpreter.c memory.c parser.c executor.c errors.c
+//   mkdir -p fuzz_corpus && cp executor_*.txt integration_*.txt parser_test1.txt fuzz_corpus/
+//   ./fuzz_interpreter -dict=fuzz.dict fuzz_corpus
+//
+// AFL (afl-clang-fast gives us __AFL_LOOP, so one process handles many inputs):
+//   afl-clang-fast -g -fsanitize=address,undefined -o fuzz_interpreter
+//       fuzz_interpreter.c memory.c parser.c executor.c errors.c
+//   afl-fuzz -i fuzz_corpus -o fuzz_out -x fuzz.dict -- ./fuzz_interpreter @@
+//
+// Plain gcc (just replays files, handy for checking a crash is fixed):
+//   gcc -g -fsanitize=address,undefined -o fuzz_interpreter
+//       fuzz_interpreter.c memory.c parser.c executor.c errors.c
+//   ./fuzz_interpreter crash-1234 fuzz_corpus/executor_basic.txt
+//
+// Between inputs we only call memory_init() + free_list(), we never restart
+// the process, so a bug that leaves junk behind shows up on the next input too.
+
+void free_list(void);
+
+// Bigger inputs than this don't find anything new, they just run slower
+#define FUZZ_MAX_INPUT 65536
+
+static char input_path[64];
+
+static void remove_input_file(void) {
+    remove(input_path);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > FUZZ_MAX_INPUT) {
+        return 0;
+    }
+
+    // parse() only knows how to read files, so the input has to go
+    // through one. Each fuzzer process gets its own file, and removes it
+    // again when it exits (libFuzzer's own main() too, and every -fork/-jobs
+    // child). Only a crash leaves it behind, next to the crash file.
+    if (input_path[0] == '\0') {
+        snprintf(input_path, sizeof(input_path), "fuzz_input_%d.txt", (int)getpid());
+        atexit(remove_input_file);
+    }
+
+    FILE *f = fopen(input_path, "wb");
+    if (!f) {
+        return 0;
+    }
+    fwrite(data, 1, size, f);
+    fclose(f);
+
+    memory_init();
+
+    int count = parse(input_path);
+    for (int i = 0; i < count; i++) {
+        execute(i);
+    }
+
+    free_list();
+    return 0;
+}
+
+// libFuzzer brings its own main(), so build with -DFUZZ_NO_MAIN for it.
+// Everyone else gets this one, which runs files (or stdin) through the
+// same function.
+#ifndef FUZZ_NO_MAIN
+#ifndef __AFL_LOOP
+// not built with afl-clang-fast: just go round once
+#define __AFL_LOOP(n) (rounds_left-- > 0)
+#endif
+
+static uint8_t buffer[FUZZ_MAX_INPUT + 1];
+
+static void run_stream(FILE *f) {
+    size_t len = fread(buffer, 1, sizeof(buffer), f);
+    LLVMFuzzerTestOneInput(buffer, len);
+}
+
+static void run_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("ERROR: Could not open %s\n", path);
+        return;
+    }
+    run_stream(f);
+    fclose(f);
+}
+
+int main(int argc, char **argv) {
+    int rounds_left = 1;
+    (void)rounds_left;
+
+    if (argc == 1) {
+        while (__AFL_LOOP(10000)) {
+            run_stream(stdin);
+        }
+    } else if (argc == 2) {
+        // AFL keeps putting the next input into the same file
+        while (__AFL_LOOP(10000)) {
+            run_file(argv[1]);
+        }
+    } else {
+        for (int i = 1; i < argc; i++) {
+            printf("Running: %s\n", argv[i]);
+            run_file(argv[i]);
+        }
+    }
+    return 0;
+}
+#endif
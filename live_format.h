@@ -0,0 +1,56 @@
+#ifndef LIVE_FORMAT_H
+#define LIVE_FORMAT_H
+
+#include <stdint.h>
+
+// Live state that run_batch publishes (RUN_BATCH_LIVE=name) while it runs,
+// and that wm_top reads. It lives in a POSIX shared memory object
+// (/dev/shm/<name> on Linux) that holds one LiveHeader.
+//
+// Every worker writes only its own LiveWorker slot, so writers never wait
+// on anything. Readers use the seq counter (a "seqlock"):
+//   writer: seq++ (now odd), write the fields, seq++ (even again)
+//   reader: read seq, copy the slot, read seq again; if it was odd or it
+//           changed, the copy may be half old and half new, so try again.
+//
+// Everything is in the byte order of the machine, and only makes sense
+// to programs built from the same version of this header.
+
+#define LIVE_MAGIC "WMLV"
+#define LIVE_VERSION 2
+#define LIVE_MAX_WORKERS 64
+#define LIVE_MAX_OPS 16         // same as MAX_OPS in run_batch, indexed by cmd_get_op()
+#define LIVE_SAMPLE_EVERY 64    // commands between two looks at the variables
+#define LIVE_DEFAULT_NAME "/wm_live"
+
+typedef struct {
+    uint32_t seq;                     // odd while the worker is writing
+    int32_t pid;
+    int32_t job;                      // program being run, -1 when idle / finished
+    int32_t command;                  // command index in that program
+    int32_t op;                       // its cmd_get_op() (numbered like TraceRecord.op)
+    int32_t cells_used;               // sum of var_size() over live variables
+    int32_t largest_var;              // biggest live variable in cells
+    int32_t finished;                 // 1 once the worker ran out of programs
+    uint64_t programs_done;
+    uint64_t commands_done;
+    uint64_t mal_refused;             // Mal that didn't create the variable
+    uint64_t mal_fragmented;          // ... even though that many cells were free in total
+    uint64_t op_counts[LIVE_MAX_OPS];
+    uint64_t updated_ns;              // CLOCK_MONOTONIC time of this snapshot
+    char live_vars[96];               // names of live variables, '\0' terminated
+} LiveWorker;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t workers;                  // slots in use
+    int32_t job_count;
+    int32_t finished;                 // 1 once run_batch has collected every worker
+    int32_t capacity;                 // cells in Main_Array, 0 if run_batch couldn't tell
+    uint64_t start_ns;
+    char source[256];                 // folder or manifest given to run_batch
+    LiveWorker worker[LIVE_MAX_WORKERS];
+} LiveHeader;
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef MEMORY_CAPACITY_H
+#define MEMORY_CAPACITY_H
+
+#include "memory.h"
+
+// How many cells Main_Array has. memory.h doesn't say, so either build with
+// -DMEMORY_CAPACITY=N, or memory_capacity() finds out: the biggest block
+// var_allocate hands out on an empty memory (which is the capacity if the
+// allocator gets that right). Used by tests_memory_stress and run_batch.
+
+void free_list(void);
+
+#ifndef MEMORY_CAPACITY
+#define MEMORY_CAPACITY 0                // 0 = find out at startup
+#endif
+#define MEMORY_CAPACITY_PROBE_LIMIT (1 << 20)
+
+static int memory_capacity_fits(char name, int size) {
+    memory_init();
+    int ok = var_allocate(name, size) == 1;
+    free_list();
+    return ok;
+}
+
+// MEMORY_CAPACITY if it was given, otherwise doubles the size until
+// var_allocate says no and then bisects. 0 if it never said no.
+// Leaves the memory empty (after free_list()).
+static int memory_capacity(char name) {
+    if (MEMORY_CAPACITY > 0) return MEMORY_CAPACITY;
+
+    int fits = 0, too_big = 0;
+    for (int size = 1; size <= MEMORY_CAPACITY_PROBE_LIMIT; size *= 2) {
+        if (!memory_capacity_fits(name, size)) {
+            too_big = size;
+            break;
+        }
+        fits = size;
+    }
+    if (too_big == 0) return 0;
+    while (too_big - fits > 1) {
+        int mid = fits + (too_big - fits) / 2;
+        if (memory_capacity_fits(name, mid)) {
+            fits = mid;
+        } else {
+            too_big = mid;
+        }
+    }
+    return fits;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define RUN_PREFIX ""
+#define EXE ".exe"
+#else
+#define RUN_PREFIX "./"
+#define EXE ""   // the Makefile only adds .exe on Windows
+#endif
+
+// Speed check: runs the benchmarks a few times, takes the median of every
+// number, and compares it with the numbers in a saved baseline file.
+// If something got noticeably slower, we exit with 1 (just like a failing
+// test), so a script can stop on a slowdown in execute()/var_get().
+//
+// Timings are only comparable on the same machine, so the baseline isn't
+// shared: record it once on every machine that runs the gate. It's also not
+// part of "make check", you run it yourself (make BUILD=release perf-gate).
+//
+// Usage:
+//   perf_gate                             compare against perf_baseline.json
+//   perf_gate --record                    save the current medians as the baseline
+//   perf_gate --reps 7 --threshold 10     7 runs each, allow up to 10% slower
+//   perf_gate --workload programs.list    what run_batch should run (default ".")
+//   perf_gate --baseline other.json
+//
+// Benchmarks print lines like "BENCH executor.execute_ns_per_command 41.2".
+// Every number is "lower is better" (time per thing).
+//
+// "Noticeably slower" means BOTH:
+//   * the median is more than --threshold percent above the baseline, and
+//   * the difference is bigger than 3 standard deviations of the runs, so
+//     one noisy run can't fail it. The standard deviation is estimated as
+//     1.4826 x the median absolute deviation (MAD), which a single very slow
+//     run doesn't throw off like it would the real one.
+
+#define MAX_BENCHES 32
+#define MAX_REPS 64
+#define NAME_LEN 64
+
+typedef struct {
+    char name[NAME_LEN];
+    double samples[MAX_REPS];
+    int sample_count;
+    double baseline;
+    int has_baseline;
+} Bench;
+
+static Bench benches[MAX_BENCHES];
+static int bench_count = 0;
+
+static Bench *find_bench(const char *name, int create) {
+    for (int i = 0; i < bench_count; i++) {
+        if (strcmp(benches[i].name, name) == 0) return &benches[i];
+    }
+    if (!create || bench_count == MAX_BENCHES) return NULL;
+    Bench *b = &benches[bench_count++];
+    memset(b, 0, sizeof(*b));
+    snprintf(b->name, NAME_LEN, "%s", name);
+    return b;
+}
+
+// Runs one benchmark command and collects every BENCH line it prints.
+// Returns 0 if the command couldn't run or failed.
+static int run_benchmark(const char *command) {
+    FILE *p = popen(command, "r");
+    if (!p) {
+        printf("ERROR: Could not run: %s\n", command);
+        return 0;
+    }
+
+    char line[256];
+    char name[NAME_LEN];
+    double value;
+    while (fgets(line, sizeof(line), p)) {
+        if (sscanf(line, "BENCH %63s %lf", name, &value) == 2) {
+            Bench *b = find_bench(name, 1);
+            if (b && b->sample_count < MAX_REPS) {
+                b->samples[b->sample_count++] = value;
+            }
+        }
+    }
+
+    int status = pclose(p);
+    if (status != 0) {
+        printf("ERROR: %s failed (status %d), its numbers don't count\n", command, status);
+        return 0;
+    }
+    return 1;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(const double *values, int n) {
+    double sorted[MAX_REPS];
+    if (n == 0) return 0.0;
+    memcpy(sorted, values, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), cmp_double);
+    return (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+}
+
+// Median absolute deviation: how far a typical run is from the median
+static double mad(const double *values, int n) {
+    double dev[MAX_REPS];
+    double m = median(values, n);
+    for (int i = 0; i < n; i++) {
+        dev[i] = values[i] > m ? values[i] - m : m - values[i];
+    }
+    return median(dev, n);
+}
+
+// The baseline file is a flat JSON object: { "name": number, ... }.
+// We just look for "name": number pairs, that's all we ever write.
+static int load_baseline(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    char line[256];
+    char name[NAME_LEN];
+    double value;
+    int loaded = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, " \"%63[^\"]\" : %lf", name, &value) == 2) {
+            Bench *b = find_bench(name, 1);
+            if (b) {
+                b->baseline = value;
+                b->has_baseline = 1;
+                loaded++;
+            }
+        }
+    }
+    fclose(f);
+    return loaded;
+}
+
+static int save_baseline(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        printf("ERROR: Could not write %s\n", path);
+        return 0;
+    }
+    fprintf(f, "{\n");
+    int written = 0;
+    for (int i = 0; i < bench_count; i++) {
+        if (benches[i].sample_count == 0) continue;
+        fprintf(f, "%s  \"%s\": %.3f", written ? ",\n" : "",
+                benches[i].name, median(benches[i].samples, benches[i].sample_count));
+        written++;
+    }
+    fprintf(f, "\n}\n");
+    fclose(f);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline_path = "perf_baseline.json";
+    const char *workload = ".";
+    int reps = 5;
+    double threshold = 5.0;
+    int record = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0) {
+            record = 1;
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+            workload = argv[++i];
+        } else {
+            printf("Usage: perf_gate [--record] [--reps N] [--threshold PCT]"
+                   " [--baseline FILE] [--workload DIR|LIST]\n");
+            return 2;
+        }
+    }
+    if (reps < 1) reps = 1;
+    if (reps > MAX_REPS) reps = MAX_REPS;
+
+    // Memory: the allocator soak in the stress test.
+    // Parser + executor: run_batch times parse() and execute() separately.
+    char commands[2][512];
+    snprintf(commands[0], sizeof(commands[0]), "%stests_memory_stress" EXE " 500", RUN_PREFIX);
+    snprintf(commands[1], sizeof(commands[1]), "%srun_batch" EXE " \"%s\"", RUN_PREFIX, workload);
+
+    printf("\n========================================\n");
+    printf("        PERFORMANCE GATE\n");
+    printf("========================================\n");
+    printf("Runs per benchmark: %d  Allowed slowdown: %.1f%%\n", reps, threshold);
+
+    if (!record) {
+        if (load_baseline(baseline_path) == 0) {
+            printf("ERROR: No baseline in %s. Make one first with: perf_gate --record\n",
+                   baseline_path);
+            return 2;
+        }
+    }
+
+    for (int r = 0; r < reps; r++) {
+        printf("  run %d of %d...\n", r + 1, reps);
+        fflush(stdout);
+        for (int c = 0; c < 2; c++) {
+            if (!run_benchmark(commands[c])) {
+                return 2;
+            }
+        }
+    }
+
+    if (record) {
+        if (!save_baseline(baseline_path)) return 2;
+        printf("\nBaseline saved to %s:\n", baseline_path);
+        for (int i = 0; i < bench_count; i++) {
+            printf("  %-40s %12.3f\n", benches[i].name,
+                   median(benches[i].samples, benches[i].sample_count));
+        }
+        return 0;
+    }
+
+    int slower = 0;
+    printf("\n%-40s %12s %12s %8s %8s  %s\n",
+           "BENCHMARK", "BASELINE", "MEDIAN", "DELTA", "NOISE", "RESULT");
+    for (int i = 0; i < bench_count; i++) {
+        Bench *b = &benches[i];
+        if (b->sample_count == 0) {
+            printf("%-40s %12.3f %12s %8s %8s  MISSING\n", b->name, b->baseline, "-", "-", "-");
+            slower++;
+            continue;
+        }
+
+        double m = median(b->samples, b->sample_count);
+        // 1.4826 * MAD ~ one standard deviation for normally distributed timings
+        double noise = 3.0 * 1.4826 * mad(b->samples, b->sample_count);
+        if (!b->has_baseline) {
+            printf("%-40s %12s %12.3f %8s %8s  new (not in baseline)\n", b->name, "-", m, "-", "-");
+            continue;
+        }
+
+        double delta = b->baseline > 0 ? (m - b->baseline) * 100.0 / b->baseline : 0.0;
+        double noise_pct = b->baseline > 0 ? noise * 100.0 / b->baseline : 0.0;
+        const char *result = "ok";
+        if (delta > threshold && m - b->baseline > noise) {
+            result = "SLOWER";
+            slower++;
+        } else if (delta < -threshold && b->baseline - m > noise) {
+            result = "faster";
+        }
+        printf("%-40s %12.3f %12.3f %+7.1f%% %7.1f%%  %s\n",
+               b->name, b->baseline, m, delta, noise_pct, result);
+    }
+
+    printf("\n");
+    if (slower == 0) {
+        printf("SUCCESS: nothing got slower than the baseline.\n");
+    } else {
+        printf("FAILURE: %d benchmark(s) got slower (or went missing).\n", slower);
+        printf("If that's expected, record a new baseline with: perf_gate --record\n");
+    }
+
+    return (slower == 0) ? 0 : 1;
+}
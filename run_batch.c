@@ -0,0 +1,1177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "memory.h"
+#include "parser.h"
+#include "executor.h"
+#include "trace_format.h"
+#include "live_format.h"
+#include "memory_capacity.h"
+
+// The trace reads a clock once per command. On x86 the time stamp counter
+// is much cheaper to read than clock_gettime/QueryPerformanceCounter, so the
+// ring holds ticks and trace_finish turns them into ns. The rate comes from
+// how far both clocks moved during the run (modern CPUs tick at a constant rate).
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_USES_TSC 1
+#endif
+
+#ifdef ALLOC_TRACK
+#include "alloc_track.h"
+#define HEAP_PHASE(p) alloc_track_set_phase(p)
+#else
+#define HEAP_PHASE(p) ((void)0)
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Batch runner: runs lots of program files through
+// memory_init -> parse -> execute -> check -> free_list
+// and says how many passed and how fast it went.
+//
+// Usage:
+//   run_batch <folder>            runs every X.txt that has an X.expected next to it
+//   run_batch <manifest.list>     runs every program path listed in the file (one per line)
+//   run_batch <...> --jobs N      use N worker processes (default 1)
+//
+// The .expected sidecar says what memory should look like after the program:
+//   x 0 5       x[0] should be 5
+//   x size 4    x should have 4 cells
+//   x freed     x should not exist any more
+//   // ...      comment line, ignored
+//
+// memory.c / parser.c / executor.c keep everything in globals, so we can't run
+// two programs on threads in the same process. Instead each worker is its own
+// process (fork) and they grab the next job off a shared counter, so a worker
+// that got the quick programs just keeps pulling more instead of sitting idle.
+// A worker that crashes (or whose interpreter calls exit()) in the middle of a
+// program gets that program marked as crashed and is replaced by a new one,
+// which carries on with the rest. On Windows we just run everything in this
+// process one after another.
+//
+// Set RUN_BATCH_STATS=stats.json to also count what the programs actually did
+// (commands run per opcode, cells changed, variables made/freed, peak cells in use)
+// and get it dumped as JSON at the end. When it isn't set the only cost is one
+// check per program.
+//
+// Set RUN_BATCH_TRACE=prefix to record every command that runs (opcode,
+// operands, timestamp) into a ring buffer per worker. Each worker writes
+// prefix.<worker>.bin when it is done; turn those into text or Chrome trace
+// JSON with trace_decode. That is one clock read and one record per command,
+// nothing else; compare run_batch's Execute time with and without it to see
+// what that is next to your execute(). Which cells changed (and their old
+// and new values) costs a copy of var1 before and after every command, so
+// that is only recorded for programs that fail their .expected: those get
+// run a second time with the copying on, and their records in the ring are
+// replaced. RUN_BATCH_TRACE_CELLS=1 records the cells for every program.
+//
+// Built with make BUILD=track, it also counts the interpreter's own heap use
+// per program (allocs and bytes in parse / execute / teardown, peak bytes)
+// and lists programs that left heap behind after free_list(), together with
+// the variables that were still alive when free_list() was called.
+//
+// Set RUN_BATCH_LIVE=name (or RUN_BATCH_LIVE=1 for the default name) to
+// publish what every worker is doing right now (program, command, opcode
+// counters, cells in use, live variables) into shared memory while the batch
+// runs. Watch it from another terminal with wm_top. Each worker only writes
+// its own slot, so nothing in the execute loop ever waits on a lock.
+
+void free_list(void);
+
+#define MAX_PATH_LEN 512
+#define MAX_MSG_LEN 160
+#define MAX_OPS 16            // parser.h has fewer opcodes than this
+#define MAX_TRACKED_CELLS 1024
+
+typedef struct {
+    char path[MAX_PATH_LEN];
+} Job;
+
+typedef struct {
+    long op_counts[MAX_OPS];  // indexed by cmd_get_op()
+    long cells_touched;       // cells whose value changed
+    long vars_allocated;      // Mal commands that really made the variable
+    long vars_freed;          // Fre commands that really got rid of it
+    int peak_cells;           // most cells in use at once
+} JobStats;
+
+typedef struct {
+    int done;          // 1 once a worker has finished this job
+    int ok;            // 1 if every expectation matched
+    int commands;      // how many commands parse() gave us
+    double usec;       // parse + execute + check time for this program
+    double parse_usec; // just the parse() call
+    double exec_usec;  // just the execute() calls
+    int crashed;       // 1 if the worker died while running it (msg says how)
+    char msg[MAX_MSG_LEN];
+    JobStats stats;    // only filled in when RUN_BATCH_STATS is set
+#ifdef ALLOC_TRACK
+    long heap_allocs[ALLOC_PHASE_COUNT];
+    long heap_bytes[ALLOC_PHASE_COUNT];
+    long heap_peak;
+    long heap_leaked;        // live bytes after free_list() minus before memory_init()
+    char leftover_vars[16];  // variables still alive when free_list() ran
+#endif
+} JobResult;
+
+static Job *jobs = NULL;
+static int job_count = 0;
+static int job_cap = 0;
+static const char *stats_path = NULL;
+static const char *trace_prefix = NULL;
+
+// Each worker only ever touches its own ring, so no locking is needed.
+static TraceRecord *trace_ring = NULL;
+static int trace_all_cells = 0;        // RUN_BATCH_TRACE_CELLS
+static uint64_t trace_written = 0;
+static uint64_t trace_last_tick = 0;   // when the previous traced command ended
+static uint64_t trace_start_tick = 0;
+static uint64_t trace_start_ns = 0;
+
+// Shared with wm_top; live_slot is this worker's own part of it
+static const char *live_name = NULL;
+static LiveHeader *live = NULL;
+static LiveWorker *live_slot = NULL;
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, t;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static double now_usec(void) {
+    return now_ns() / 1e3;
+}
+
+static uint64_t trace_tick(void) {
+#ifdef TRACE_USES_TSC
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+static void add_job(const char *path) {
+    if (job_count == job_cap) {
+        job_cap = job_cap ? job_cap * 2 : 64;
+        jobs = realloc(jobs, job_cap * sizeof(Job));
+        if (!jobs) {
+            printf("ERROR: out of memory while building the job list\n");
+            exit(2);
+        }
+    }
+    snprintf(jobs[job_count].path, MAX_PATH_LEN, "%s", path);
+    job_count++;
+}
+
+// "folder/prog.txt" -> "folder/prog.expected"
+static void sidecar_path(const char *program, char *out, size_t out_len) {
+    snprintf(out, out_len, "%s", program);
+    char *dot = strrchr(out, '.');
+    char *slash = strrchr(out, '/');
+    if (dot && (!slash || dot > slash)) {
+        *dot = '\0';
+    }
+    strncat(out, ".expected", out_len - strlen(out) - 1);
+}
+
+static int file_exists(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    fclose(f);
+    return 1;
+}
+
+static int ends_with(const char *s, const char *suffix) {
+    size_t ls = strlen(s), lx = strlen(suffix);
+    return ls >= lx && strcmp(s + ls - lx, suffix) == 0;
+}
+
+static void add_if_has_sidecar(const char *dir, const char *name) {
+    char path[MAX_PATH_LEN];
+    char expected[MAX_PATH_LEN];
+    if (!ends_with(name, ".txt")) return;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    sidecar_path(path, expected, sizeof(expected));
+    if (file_exists(expected)) {
+        add_job(path);
+    }
+}
+
+// Returns 1 if we managed to list the folder, 0 if it isn't a folder.
+static int collect_from_dir(const char *dir) {
+#ifdef _WIN32
+    char pattern[MAX_PATH_LEN];
+    WIN32_FIND_DATAA fd;
+    snprintf(pattern, sizeof(pattern), "%s\\*.txt", dir);
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    if (h == INVALID_HANDLE_VALUE) {
+        DWORD attrs = GetFileAttributesA(dir);
+        return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY);
+    }
+    do {
+        add_if_has_sidecar(dir, fd.cFileName);
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+    return 1;
+#else
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        add_if_has_sidecar(dir, e->d_name);
+    }
+    closedir(d);
+    return 1;
+#endif
+}
+
+static void collect_from_manifest(const char *manifest) {
+    FILE *f = fopen(manifest, "r");
+    if (!f) {
+        printf("ERROR: Could not open %s\n", manifest);
+        exit(2);
+    }
+    char line[MAX_PATH_LEN];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+        add_job(line);
+    }
+    fclose(f);
+}
+
+// Checks memory against the .expected file. Fills msg on the first mismatch.
+static int check_expectations(const char *program, char *msg, size_t msg_len) {
+    char expected[MAX_PATH_LEN];
+    sidecar_path(program, expected, sizeof(expected));
+
+    FILE *f = fopen(expected, "r");
+    if (!f) {
+        snprintf(msg, msg_len, "no sidecar %.100s", expected);
+        return 0;
+    }
+
+    char line[128];
+    int line_no = 0;
+    int ok = 1;
+    while (ok && fgets(line, sizeof(line), f)) {
+        char name;
+        char word[32];
+        int value = 0;
+        line_no++;
+
+        int fields = sscanf(line, " %c %31s %d", &name, word, &value);
+        if (fields < 1 || name == '/') {
+            continue; // blank or comment
+        }
+
+        Variable v = var_get(name);
+        if (fields == 2 && strcmp(word, "freed") == 0) {
+            if (v != NULL) {
+                snprintf(msg, msg_len, "line %d: %c should be freed", line_no, name);
+                ok = 0;
+            }
+        } else if (fields == 3 && strcmp(word, "size") == 0) {
+            if (v == NULL || var_size(v) != value) {
+                snprintf(msg, msg_len, "line %d: %c should have size %d, got %d",
+                         line_no, name, value, v ? var_size(v) : -1);
+                ok = 0;
+            }
+        } else if (fields == 3) {
+            int index = atoi(word);
+            if (v == NULL) {
+                snprintf(msg, msg_len, "line %d: %c should exist", line_no, name);
+                ok = 0;
+            } else if (var_read_at(v, index) != value) {
+                snprintf(msg, msg_len, "line %d: %c[%d] should be %d, got %d",
+                         line_no, name, index, value, var_read_at(v, index));
+                ok = 0;
+            }
+        } else {
+            snprintf(msg, msg_len, "line %d of the .expected file makes no sense", line_no);
+            ok = 0;
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+
+// Copies the cells of a variable into out, returns how many (0 if it doesn't exist).
+// Every cell, not just the ones a working execute() would change: the trace
+// is for finding the commands that write where they shouldn't.
+static int snapshot_var(char name, int *out) {
+    Variable v = var_get(name);
+    if (v == NULL) return 0;
+    int size = var_size(v);
+    if (size > MAX_TRACKED_CELLS) size = MAX_TRACKED_CELLS;
+    for (int k = 0; k < size; k++) {
+        out[k] = var_read_at(v, k);
+    }
+    return size;
+}
+
+// Adds up the size of every live variable. Names are single printable characters.
+static int cells_in_use(void) {
+    int total = 0;
+    for (int c = 33; c < 127; c++) {
+        Variable v = var_get((char)c);
+        if (v != NULL) total += var_size(v);
+    }
+    return total;
+}
+
+// Puts one command into the trace ring. Only one clock read per command:
+// each record starts where the previous one in this program ended
+// (trace_last_tick, set before the first command).
+static void trace_put(int job, int i, Command c, uint64_t end,
+                      int cell, int old_value, int new_value) {
+    TraceRecord *r = &trace_ring[trace_written % TRACE_RING_RECORDS];
+    r->timestamp_ns = trace_last_tick;   // in ticks until trace_finish
+    r->duration_ns = (uint32_t)(end - trace_last_tick);
+    trace_last_tick = end;
+    r->job = job;
+    r->command = i;
+    r->op = cmd_get_op(c);
+    r->number = cmd_get_number(c);
+    r->cell = cell;
+    r->old_value = old_value;
+    r->new_value = new_value;
+    r->var1 = cmd_get_var1(c);
+    r->var2 = cmd_get_var2(c);
+    memset(r->pad, 0, sizeof(r->pad));
+    trace_written++;
+}
+
+// execute(i) plus a trace record without looking at any cells (cell -3)
+static void execute_traced(int job, int i) {
+    execute(i);
+    uint64_t end = trace_tick();
+    Command c = get_command(i);
+    if (c != NULL) {
+        trace_put(job, i, c, end, -3, 0, 0);
+    }
+}
+
+// Same as execute(i) but also fills in the stats and/or the trace
+// (whichever are switched on) by looking at var1 before and after.
+static void execute_watched(int job, int i, JobStats *st) {
+    static int before[MAX_TRACKED_CELLS];
+    static int after[MAX_TRACKED_CELLS];
+
+    Command c = get_command(i);
+    if (c == NULL) {
+        execute(i);
+        return;
+    }
+    char name = cmd_get_var1(c);
+    int op = cmd_get_op(c);
+
+    int before_size = snapshot_var(name, before);
+    execute(i);
+    uint64_t end = trace_ring ? trace_tick() : 0;
+    int after_size = snapshot_var(name, after);
+
+    // -1 = whole variable appeared/vanished/resized, -2 = nothing changed
+    int cell = -2;
+    int old_value = 0, new_value = 0;
+    int changed = 0;
+
+    if (before_size != after_size) {
+        cell = -1;
+        old_value = before_size;
+        new_value = after_size;
+        changed = before_size > after_size ? before_size : after_size;
+    } else {
+        for (int k = 0; k < after_size; k++) {
+            if (before[k] != after[k]) {
+                if (cell == -2) {
+                    cell = k;
+                    old_value = before[k];
+                    new_value = after[k];
+                }
+                changed++;
+            }
+        }
+    }
+
+    if (st) {
+        if (op >= 0 && op < MAX_OPS) {
+            st->op_counts[op]++;
+        }
+        st->cells_touched += changed;
+        if (op == MAL && before_size == 0 && after_size > 0) st->vars_allocated++;
+        if (op == FRE && before_size > 0 && after_size == 0) st->vars_freed++;
+        // cells in use only go up when a variable appears or grows
+        if (after_size > before_size) {
+            int in_use = cells_in_use();
+            if (in_use > st->peak_cells) {
+                st->peak_cells = in_use;
+            }
+        }
+    }
+
+    if (trace_ring) {
+        trace_put(job, i, c, end, cell, old_value, new_value);
+    }
+}
+
+// Runs one command the cheapest way that still gets everything switched on
+static void execute_one(int job, int i, JobStats *st) {
+    if (st || (trace_ring && trace_all_cells)) {
+        execute_watched(job, i, st);
+    } else if (trace_ring) {
+        execute_traced(job, i);
+    } else {
+        execute(i);
+    }
+}
+
+#ifndef _WIN32
+// Seqlock write side: only this worker writes its slot, so the counter just
+// tells readers "I'm in the middle of it" (odd) or "it's consistent" (even).
+static void live_begin_write(void) {
+    __atomic_store_n(&live_slot->seq, live_slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void live_end_write(void) {
+    __atomic_store_n(&live_slot->seq, live_slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    int cells_used;
+    int largest_var;
+    char names[sizeof(((LiveWorker *)0)->live_vars)];
+} LiveSample;
+
+// Looks at every variable name; done outside the write so readers rarely retry
+static void live_take_sample(LiveSample *out) {
+    int count = 0;
+    out->cells_used = 0;
+    out->largest_var = 0;
+    for (int c = 33; c < 127; c++) {
+        Variable v = var_get((char)c);
+        if (v == NULL) continue;
+        int size = var_size(v);
+        out->cells_used += size;
+        if (size > out->largest_var) out->largest_var = size;
+        if (count < (int)sizeof(out->names) - 1) out->names[count++] = (char)c;
+    }
+    out->names[count] = '\0';
+}
+
+static void live_put_sample(const LiveSample *sample) {
+    live_slot->cells_used = sample->cells_used;
+    live_slot->largest_var = sample->largest_var;
+    memcpy(live_slot->live_vars, sample->names, sizeof(sample->names));
+    live_slot->updated_ns = now_ns();
+}
+
+// execute_one(i) and then tell
+// wm_top about it. Counters are updated every command; the variables are
+// only looked at every LIVE_SAMPLE_EVERY commands and when a Mal got refused,
+// because going over every name costs more than the command itself.
+static void execute_live(int job, int i, JobStats *st) {
+    Command c = get_command(i);
+    int op = c ? cmd_get_op(c) : -1;
+    char name = c ? cmd_get_var1(c) : 0;
+    int was_missing = (op == MAL) && var_get(name) == NULL;
+
+    execute_one(job, i, st);
+
+    int refused = was_missing && var_get(name) == NULL;
+    int sample_now = refused || (live_slot->commands_done + 1) % LIVE_SAMPLE_EVERY == 0;
+    LiveSample sample;
+    if (sample_now) {
+        live_take_sample(&sample);
+    }
+
+    live_begin_write();
+    live_slot->job = job;
+    live_slot->command = i;
+    live_slot->op = op;
+    live_slot->commands_done++;
+    if (op >= 0 && op < LIVE_MAX_OPS) {
+        live_slot->op_counts[op]++;
+    }
+    if (refused) {
+        // same as in tests_memory_stress: no room in one piece, but enough in total
+        live_slot->mal_refused++;
+        if (live->capacity > 0 && sample.cells_used + cmd_get_number(c) <= live->capacity) {
+            live_slot->mal_fragmented++;
+        }
+    }
+    if (sample_now) {
+        live_put_sample(&sample);
+    }
+    live_end_write();
+}
+
+static void live_program_done(void) {
+    live_begin_write();
+    live_slot->job = -1;
+    live_slot->command = -1;
+    live_slot->op = -1;
+    live_slot->cells_used = 0;
+    live_slot->largest_var = 0;
+    live_slot->live_vars[0] = '\0';
+    live_slot->programs_done++;
+    live_slot->updated_ns = now_ns();
+    live_end_write();
+}
+
+static void live_worker_start(int worker) {
+    if (!live || worker >= LIVE_MAX_WORKERS) return;
+    live_slot = &live->worker[worker];
+    // a worker that crashed in this slot before us may have left seq odd
+    if (live_slot->seq & 1) {
+        live_end_write();
+    }
+    live_begin_write();
+    live_slot->pid = (int32_t)getpid();
+    live_slot->job = -1;
+    live_slot->command = -1;
+    live_slot->op = -1;
+    live_slot->updated_ns = now_ns();
+    live_end_write();
+}
+
+static void live_worker_finish(void) {
+    if (!live_slot) return;
+    live_begin_write();
+    live_slot->finished = 1;
+    live_slot->updated_ns = now_ns();
+    live_end_write();
+    live_slot = NULL;
+}
+
+// Parent side: a worker died and nobody replaces it, so it won't say it's done
+static void live_worker_died(int worker) {
+    if (!live || worker >= LIVE_MAX_WORKERS) return;
+    live_slot = &live->worker[worker];
+    if (!(live_slot->seq & 1)) {
+        live_begin_write();
+    }
+    live_slot->job = -1;
+    live_slot->finished = 1;
+    live_slot->updated_ns = now_ns();
+    live_end_write();
+    live_slot = NULL;
+}
+
+// Makes the shared memory object before the workers are forked, so they all
+// get it mapped at the same place. Returns 0 (and the batch runs without it)
+// if that didn't work.
+static int live_open(const char *source, int workers) {
+    int fd = shm_open(live_name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        perror("shm_open");
+        return 0;
+    }
+    if (ftruncate(fd, sizeof(LiveHeader)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(live_name);
+        return 0;
+    }
+    void *mem = mmap(NULL, sizeof(LiveHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(live_name);
+        return 0;
+    }
+
+    live = (LiveHeader *)mem;
+    memset(live, 0, sizeof(*live));
+    live->version = LIVE_VERSION;
+    live->workers = workers < LIVE_MAX_WORKERS ? workers : LIVE_MAX_WORKERS;
+    live->job_count = job_count;
+    live->start_ns = now_ns();
+    // before any worker exists, so probing can't get in a program's way
+    live->capacity = memory_capacity('a');
+    snprintf(live->source, sizeof(live->source), "%s", source);
+    // magic last, so wm_top never sees a half filled in header
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(live->magic, LIVE_MAGIC, 4);
+    return 1;
+}
+
+static void live_close(void) {
+    if (!live) return;
+    __atomic_store_n(&live->finished, 1, __ATOMIC_RELEASE);
+    munmap(live, sizeof(LiveHeader));
+    live = NULL;
+    // a wm_top that's still attached keeps its mapping and sees "finished"
+    shm_unlink(live_name);
+}
+#endif
+
+static void trace_start(void) {
+    if (!trace_prefix) return;
+    trace_ring = malloc(TRACE_RING_RECORDS * sizeof(TraceRecord));
+    trace_written = 0;
+    trace_start_ns = now_ns();
+    trace_start_tick = trace_tick();
+    if (!trace_ring) {
+        fprintf(stderr, "ERROR: out of memory for the trace ring, tracing is off\n");
+    }
+}
+
+// Turns the ticks in the ring into ns on the same clock as now_ns()
+static void trace_ticks_to_ns(uint32_t stored) {
+#ifdef TRACE_USES_TSC
+    uint64_t end_tick = trace_tick();
+    uint64_t end_ns = now_ns();
+    double ns_per_tick = end_tick > trace_start_tick
+                             ? (double)(end_ns - trace_start_ns) / (double)(end_tick - trace_start_tick)
+                             : 1.0;
+    for (uint32_t k = 0; k < stored; k++) {
+        TraceRecord *r = &trace_ring[k];
+        r->timestamp_ns = trace_start_ns +
+                          (uint64_t)((double)(r->timestamp_ns - trace_start_tick) * ns_per_tick);
+        r->duration_ns = (uint32_t)(r->duration_ns * ns_per_tick);
+    }
+#else
+    (void)stored;   // the ring already holds ns
+#endif
+}
+
+static void trace_finish(int worker) {
+    if (!trace_ring) return;
+
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%.480s.%d.bin", trace_prefix, worker);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: Could not write trace to %s\n", path);
+        free(trace_ring);
+        trace_ring = NULL;
+        return;
+    }
+
+    uint32_t version = TRACE_VERSION;
+    uint32_t count = (uint32_t)job_count;
+    fwrite(TRACE_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&count, sizeof(count), 1, f);
+    for (int j = 0; j < job_count; j++) {
+        uint16_t len = (uint16_t)strlen(jobs[j].path);
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(jobs[j].path, 1, len, f);
+    }
+
+    uint32_t stored = trace_written < TRACE_RING_RECORDS
+                          ? (uint32_t)trace_written : TRACE_RING_RECORDS;
+    uint32_t oldest = (uint32_t)((trace_written - stored) % TRACE_RING_RECORDS);
+    trace_ticks_to_ns(stored);
+    fwrite(&trace_written, sizeof(trace_written), 1, f);
+    fwrite(&stored, sizeof(stored), 1, f);
+
+    // oldest first: from oldest to the end of the ring, then wrap around
+    uint32_t first_part = TRACE_RING_RECORDS - oldest;
+    if (first_part > stored) first_part = stored;
+    fwrite(&trace_ring[oldest], sizeof(TraceRecord), first_part, f);
+    fwrite(&trace_ring[0], sizeof(TraceRecord), stored - first_part, f);
+
+    fclose(f);
+    free(trace_ring);
+    trace_ring = NULL;
+}
+
+// A traced program that failed its .expected gets run again from the start,
+// this time with every cell of var1 compared before and after each command.
+// Its records in the ring (from first_record on) get replaced by those.
+// Everything here is deterministic, so the second run does the same thing
+// as the first; only its durations include the copying.
+static void trace_replay(int job_index, uint64_t first_record) {
+    trace_written = first_record;
+    memory_init();
+    int count = parse(jobs[job_index].path);
+    trace_last_tick = trace_tick();
+    for (int i = 0; i < count; i++) {
+        execute_watched(job_index, i, NULL);
+    }
+    free_list();
+}
+
+static void run_one(int job_index, JobResult *res) {
+    const Job *job = &jobs[job_index];
+#ifdef ALLOC_TRACK
+    long heap_before = alloc_track_live_bytes();
+    long allocs_before[ALLOC_PHASE_COUNT], bytes_before[ALLOC_PHASE_COUNT];
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+        allocs_before[p] = alloc_track_count((AllocPhase)p);
+        bytes_before[p] = alloc_track_bytes((AllocPhase)p);
+    }
+    alloc_track_reset_peak();
+#endif
+    double start = now_usec();
+    uint64_t trace_first = 0;
+    int traced_cells = stats_path || trace_all_cells;
+
+    HEAP_PHASE(ALLOC_PHASE_OTHER);
+    memory_init();
+    HEAP_PHASE(ALLOC_PHASE_PARSE);
+    double parse_start = now_usec();
+    int count = parse(job->path);
+    res->parse_usec = now_usec() - parse_start;
+    HEAP_PHASE(ALLOC_PHASE_EXECUTE);
+    res->commands = count > 0 ? count : 0;
+
+    if (count < 0) {
+        res->ok = 0;
+        snprintf(res->msg, MAX_MSG_LEN, "could not parse");
+    } else {
+        double exec_start = now_usec();
+        JobStats *st = stats_path ? &res->stats : NULL;
+        if (trace_ring) {
+            trace_first = trace_written;
+            trace_last_tick = trace_tick();
+        }
+#ifndef _WIN32
+        if (live_slot) {
+            for (int i = 0; i < count; i++) {
+                execute_live(job_index, i, st);
+            }
+        } else
+#endif
+        if (st || trace_ring) {
+            for (int i = 0; i < count; i++) {
+                execute_one(job_index, i, st);
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                execute(i);
+            }
+        }
+        res->exec_usec = now_usec() - exec_start;
+        res->ok = check_expectations(job->path, res->msg, MAX_MSG_LEN);
+    }
+
+#ifdef ALLOC_TRACK
+    int leftover = 0;
+    for (int c = 33; c < 127 && leftover < (int)sizeof(res->leftover_vars) - 1; c++) {
+        if (var_get((char)c) != NULL) {
+            res->leftover_vars[leftover++] = (char)c;
+        }
+    }
+    res->leftover_vars[leftover] = '\0';
+#endif
+
+    HEAP_PHASE(ALLOC_PHASE_TEARDOWN);
+    free_list();
+    HEAP_PHASE(ALLOC_PHASE_OTHER);
+#ifndef _WIN32
+    if (live_slot) {
+        live_program_done();
+    }
+#endif
+
+    res->usec = now_usec() - start;
+#ifdef ALLOC_TRACK
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+        res->heap_allocs[p] = alloc_track_count((AllocPhase)p) - allocs_before[p];
+        res->heap_bytes[p] = alloc_track_bytes((AllocPhase)p) - bytes_before[p];
+    }
+    res->heap_peak = alloc_track_peak_bytes() - heap_before;
+    res->heap_leaked = alloc_track_live_bytes() - heap_before;
+#endif
+    // after the heap numbers, so the second run doesn't show up in them
+    if (trace_ring && !traced_cells && count > 0 && !res->ok) {
+        trace_replay(job_index, trace_first);
+    }
+    res->done = 1;
+}
+
+#ifdef _WIN32
+static void run_serial(JobResult *results) {
+    trace_start();
+    for (int i = 0; i < job_count; i++) {
+        run_one(i, &results[i]);
+    }
+    trace_finish(0);
+}
+#else
+// Forks worker number w. It keeps taking the next job until there are none
+// left, with current_job[w] saying which one it's on (-1 between programs).
+static pid_t start_worker(JobResult *results, int *next_job, int *current_job, int w) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        // Pri/Pra output from the programs would just be noise here
+        if (!freopen("/dev/null", "w", stdout)) {
+            _exit(2);
+        }
+        trace_start();
+        live_worker_start(w);
+        for (;;) {
+            int i = __atomic_fetch_add(next_job, 1, __ATOMIC_RELAXED);
+            if (i >= job_count) break;
+            __atomic_store_n(&current_job[w], i, __ATOMIC_RELEASE);
+            run_one(i, &results[i]);
+            __atomic_store_n(&current_job[w], -1, __ATOMIC_RELEASE);
+        }
+        live_worker_finish();
+        trace_finish(w);
+        // exit(), not _exit(), so profiling data (-pg, -fprofile-generate)
+        // from this worker gets written too
+        exit(0);
+    }
+    return pid;
+}
+
+static void run_workers(JobResult *results, int *next_job, int *current_job, int workers) {
+    pid_t *pids = malloc(workers * sizeof(pid_t));
+    if (!pids) {
+        printf("ERROR: out of memory for the worker list\n");
+        exit(2);
+    }
+    int running = 0;
+    for (int w = 0; w < workers; w++) {
+        current_job[w] = -1;
+        pids[w] = start_worker(results, next_job, current_job, w);
+        if (pids[w] > 0) running++;
+    }
+
+    while (running > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        int w = 0;
+        while (w < workers && pids[w] != pid) w++;
+        if (w == workers) continue;
+        pids[w] = -1;
+        running--;
+
+        int job = __atomic_load_n(&current_job[w], __ATOMIC_ACQUIRE);
+        if (job < 0 || results[job].done) continue;   // it ran out of jobs, all fine
+
+        // died in the middle of a program: blame that program, keep going with the rest
+        current_job[w] = -1;
+        results[job].crashed = 1;
+        if (WIFSIGNALED(status)) {
+            snprintf(results[job].msg, MAX_MSG_LEN, "crashed (signal %d)", WTERMSIG(status));
+        } else {
+            // exit() somewhere in the interpreter, or a sanitizer stopping it
+            snprintf(results[job].msg, MAX_MSG_LEN, "worker exited with %d in the middle of it",
+                     WEXITSTATUS(status));
+        }
+        printf("Worker %d died on %s: %s\n", w, jobs[job].path, results[job].msg);
+
+        if (__atomic_load_n(next_job, __ATOMIC_RELAXED) < job_count) {
+            pids[w] = start_worker(results, next_job, current_job, w);
+            if (pids[w] > 0) running++;
+        }
+        if (pids[w] <= 0) {
+            live_worker_died(w);
+        }
+    }
+    free(pids);
+}
+#endif
+
+static void write_stats(const JobResult *results) {
+    JobStats total;
+    long commands = 0;
+    memset(&total, 0, sizeof(total));
+
+    for (int i = 0; i < job_count; i++) {
+        const JobStats *st = &results[i].stats;
+        for (int op = 0; op < MAX_OPS; op++) {
+            total.op_counts[op] += st->op_counts[op];
+        }
+        total.cells_touched += st->cells_touched;
+        total.vars_allocated += st->vars_allocated;
+        total.vars_freed += st->vars_freed;
+        if (st->peak_cells > total.peak_cells) {
+            total.peak_cells = st->peak_cells;
+        }
+        commands += results[i].commands;
+    }
+
+    FILE *f = fopen(stats_path, "w");
+    if (!f) {
+        printf("ERROR: Could not write stats to %s\n", stats_path);
+        return;
+    }
+
+    // op ids are numbered like TraceRecord.op (see trace_format.h)
+    fprintf(f, "{\n");
+    fprintf(f, "  \"programs\": %d,\n", job_count);
+    fprintf(f, "  \"commands\": %ld,\n", commands);
+    fprintf(f, "  \"op_counts\": {");
+    int first = 1;
+    for (int op = 0; op < MAX_OPS; op++) {
+        if (total.op_counts[op] == 0) continue;
+        fprintf(f, "%s\"%d\": %ld", first ? "" : ", ", op, total.op_counts[op]);
+        first = 0;
+    }
+    fprintf(f, "},\n");
+    // the commands, refused ones included, and how many of them did something
+    fprintf(f, "  \"mal_commands\": %ld,\n", total.op_counts[MAL]);
+    fprintf(f, "  \"fre_commands\": %ld,\n", total.op_counts[FRE]);
+    fprintf(f, "  \"variables_allocated\": %ld,\n", total.vars_allocated);
+    fprintf(f, "  \"variables_freed\": %ld,\n", total.vars_freed);
+    fprintf(f, "  \"cells_touched\": %ld,\n", total.cells_touched);
+    fprintf(f, "  \"peak_cells_in_use\": %d\n", total.peak_cells);
+    fprintf(f, "}\n");
+    fclose(f);
+
+    printf("  Stats written to %s\n", stats_path);
+}
+
+#ifdef ALLOC_TRACK
+static const char *heap_phase_names[ALLOC_PHASE_COUNT] = {
+    "other", "parse", "execute", "teardown"
+};
+
+// Returns how many programs left heap behind after free_list()
+static int report_heap(const JobResult *results) {
+    long allocs[ALLOC_PHASE_COUNT] = {0};
+    long bytes[ALLOC_PHASE_COUNT] = {0};
+    long peak = 0;
+    int leaky = 0;
+
+    for (int i = 0; i < job_count; i++) {
+        for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+            allocs[p] += results[i].heap_allocs[p];
+            bytes[p] += results[i].heap_bytes[p];
+        }
+        if (results[i].heap_peak > peak) peak = results[i].heap_peak;
+    }
+
+    printf("\nHEAP (interpreter only):\n");
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++) {
+        printf("  %-9s %8ld allocs %10ld bytes  (%.1f allocs/program)\n",
+               heap_phase_names[p], allocs[p], bytes[p], (double)allocs[p] / job_count);
+    }
+    printf("  Peak live bytes in one program: %ld\n", peak);
+
+    for (int i = 0; i < job_count; i++) {
+        if (results[i].heap_leaked <= 0) continue;
+        if (leaky < 10) {
+            printf("  LEAK: %s kept %ld bytes after free_list()", jobs[i].path,
+                   results[i].heap_leaked);
+            if (results[i].leftover_vars[0] != '\0') {
+                printf(", still alive at free_list(): %s", results[i].leftover_vars);
+            }
+            printf("\n");
+        }
+        leaky++;
+    }
+    if (leaky > 10) {
+        printf("  ... and %d more programs leaked\n", leaky - 10);
+    }
+    printf("  Programs that leaked: %d\n", leaky);
+    return leaky;
+}
+#endif
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+    if (n == 0) return 0.0;
+    int idx = (int)(p * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+int main(int argc, char **argv) {
+    const char *source = NULL;
+    int workers = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1) workers = 1;
+        } else {
+            source = argv[i];
+        }
+    }
+
+    if (!source) {
+        printf("Usage: run_batch <folder | manifest> [--jobs N]\n");
+        return 2;
+    }
+
+    stats_path = getenv("RUN_BATCH_STATS");
+    if (stats_path && stats_path[0] == '\0') {
+        stats_path = NULL;
+    }
+    trace_prefix = getenv("RUN_BATCH_TRACE");
+    if (trace_prefix && trace_prefix[0] == '\0') {
+        trace_prefix = NULL;
+    }
+    const char *all_cells = getenv("RUN_BATCH_TRACE_CELLS");
+    trace_all_cells = all_cells && all_cells[0] != '\0' && strcmp(all_cells, "0") != 0;
+    live_name = getenv("RUN_BATCH_LIVE");
+    if (live_name && (live_name[0] == '\0' || strcmp(live_name, "0") == 0)) {
+        live_name = NULL;
+    }
+    char live_name_buf[256];
+    if (live_name) {
+        // shm names have to start with a single '/'
+        if (strcmp(live_name, "1") == 0) {
+            live_name = LIVE_DEFAULT_NAME;
+        } else if (live_name[0] != '/') {
+            snprintf(live_name_buf, sizeof(live_name_buf), "/%.250s", live_name);
+            live_name = live_name_buf;
+        }
+    }
+
+    if (!collect_from_dir(source)) {
+        collect_from_manifest(source);
+    }
+
+    if (job_count == 0) {
+        printf("No programs found in %s\n", source);
+        return 2;
+    }
+
+    JobResult *results;
+#ifdef _WIN32
+    results = calloc(job_count, sizeof(JobResult));
+#else
+    // results, the job counter and what each worker is on are shared with
+    // the worker processes
+    size_t shared_len = job_count * sizeof(JobResult) + (1 + workers) * sizeof(int);
+    void *shared = mmap(NULL, shared_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        perror("mmap");
+        return 2;
+    }
+    memset(shared, 0, shared_len);
+    results = (JobResult *)shared;
+    int *next_job = (int *)(results + job_count);
+    int *current_job = next_job + 1;
+#endif
+
+    printf("\n========================================\n");
+    printf("        BATCH RUN: %d programs\n", job_count);
+    printf("========================================\n");
+
+#ifdef _WIN32
+    if (live_name) {
+        printf("RUN_BATCH_LIVE needs POSIX shared memory, ignoring it on Windows\n");
+    }
+#else
+    if (live_name && live_open(source, workers)) {
+        printf("Live state in shared memory %s (watch it with: wm_top %s)\n",
+               live_name, live_name);
+    }
+#endif
+
+    double start = now_usec();
+#ifdef _WIN32
+    (void)workers;
+    run_serial(results);
+#else
+    // even with 1 job we fork, so program output stays out of the report
+    run_workers(results, next_job, current_job, workers);
+    live_close();
+#endif
+    double wall = now_usec() - start;
+
+    int passed = 0, failed = 0;
+    long total_commands = 0;
+    double total_parse = 0.0, total_exec = 0.0;
+    double *lat = malloc(job_count * sizeof(double));
+    int lat_count = 0;
+
+    for (int i = 0; i < job_count; i++) {
+        if (results[i].crashed) {
+            printf("FAIL: %s: %s\n", jobs[i].path, results[i].msg);
+            failed++;
+            continue;
+        }
+        if (!results[i].done) {
+            printf("FAIL: %s (worker died before finishing it)\n", jobs[i].path);
+            failed++;
+            continue;
+        }
+        if (results[i].ok) {
+            passed++;
+        } else {
+            printf("FAIL: %s: %s\n", jobs[i].path, results[i].msg);
+            failed++;
+        }
+        total_commands += results[i].commands;
+        total_parse += results[i].parse_usec;
+        total_exec += results[i].exec_usec;
+        lat[lat_count++] = results[i].usec;
+    }
+
+    qsort(lat, lat_count, sizeof(double), cmp_double);
+    double secs = wall / 1e6;
+
+    printf("\nBATCH RESULTS:\n");
+    printf("  Programs passed: %d\n", passed);
+    printf("  Programs failed: %d\n", failed);
+    printf("  Workers:         %d\n", workers);
+    printf("  Wall time:       %.3f s\n", secs);
+    printf("  Programs/sec:    %.1f\n", secs > 0 ? job_count / secs : 0.0);
+    printf("  Commands/sec:    %.1f\n", secs > 0 ? total_commands / secs : 0.0);
+    printf("  Latency p50:     %.1f us\n", percentile(lat, lat_count, 0.50));
+    printf("  Latency p90:     %.1f us\n", percentile(lat, lat_count, 0.90));
+    printf("  Latency p99:     %.1f us\n", percentile(lat, lat_count, 0.99));
+    printf("  Latency max:     %.1f us\n", lat_count ? lat[lat_count - 1] : 0.0);
+    printf("  Parse time:      %.1f us/program\n", lat_count ? total_parse / lat_count : 0.0);
+    printf("  Execute time:    %.1f ns/command\n",
+           total_commands ? total_exec * 1e3 / total_commands : 0.0);
+    if (stats_path) {
+        write_stats(results);
+    }
+#ifdef ALLOC_TRACK
+    // in the track build a leak counts as a failed program, so CI catches it
+    failed += report_heap(results);
+#endif
+    printf("========================================\n");
+
+    // one line per number, lower is better; perf_gate reads these
+    if (lat_count > 0 && total_commands > 0) {
+        printf("BENCH parser.parse_us_per_program %.3f\n", total_parse / lat_count);
+        printf("BENCH executor.execute_ns_per_command %.3f\n", total_exec * 1e3 / total_commands);
+        printf("BENCH batch.program_us_p50 %.3f\n", percentile(lat, lat_count, 0.50));
+    }
+
+    free(lat);
+    free(jobs);
+#ifdef _WIN32
+    free(results);
+#else
+    munmap(shared, shared_len);
+#endif
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -2,8 +2,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/stat.h>
+
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/select.h>
 #endif
 
 // Simple text-based menu system for Windows
@@ -17,11 +26,16 @@ void run_integration_tests(void);
 void show_test_descriptions(void);
 void print_help_advice(void);
 void wait_for_enter(void);
+int watch_mode(void);
 
-int main() {
+int main(int argc, char **argv) {
     int choice;
     char input[10];
     
+    if (argc > 1 && strcmp(argv[1], "--watch") == 0) {
+        return watch_mode();
+    }
+    
     print_banner();
     
     while (1) {
@@ -308,6 +322,12 @@ void print_help_advice(void) {
     printf("  gcc -o tests_executor.exe tests_executor.c memory.c parser.c executor.c errors.c\n");
     printf("  gcc -o tests_integration.exe tests_integration.c memory.c parser.c executor.c errors.c\n");
     printf("  gcc -o test_runner.exe test_runner.c\n");
+    printf("Or, if you have make, build everything at once with:\n");
+    printf("  make -j\n");
+    
+    printf("\nWATCH MODE:\n");
+    printf("  test_runner.exe --watch\n");
+    printf("  Rebuilds and reruns only the suites that use a file you just saved.\n");
     
     printf("\nIMPORTANT FOR WINDOWS USERS:\n");
     printf("* All test files must have .exe extension\n");
@@ -334,4 +354,294 @@ void print_help_advice(void) {
     printf("   * 0 = All tests passed\n");
     printf("   * 1 = Some tests failed\n");
     printf("   * Other codes = Compilation or runtime errors\n");
+}
+
+// ---------------------------------------------------------------------------
+// Watch mode: ./test_runner --watch
+//
+// Keeps an eye on the interpreter sources, the test sources and the .txt
+// programs. When something changes it only rebuilds the test programs that
+// use that file and only reruns those suites. E.g. editing parser.c reruns
+// parser, executor and integration, but not memory.
+// On Linux we get told about changes (inotify), everywhere else we check the
+// file times twice a second.
+// ---------------------------------------------------------------------------
+
+// The Makefile (and gcc) only put .exe on the end on Windows. Elsewhere the
+// tests get built without it, so the prebuilt Windows .exe files stay as they are.
+#ifdef _WIN32
+#define RUN_PREFIX ""
+#define EXE ".exe"
+#else
+#define RUN_PREFIX "./"
+#define EXE ""
+#endif
+
+#define WATCH_MAX_FILES 12
+
+typedef struct {
+    const char *name;
+    const char *binary;
+    const char *build;
+    const char *sources[WATCH_MAX_FILES];  // changing these means rebuild + rerun
+    const char *programs[WATCH_MAX_FILES]; // changing these only means rerun
+} WatchSuite;
+
+static const WatchSuite watch_suites[] = {
+    {
+        "MEMORY", "tests_memory" EXE,
+        "gcc -o tests_memory tests_memory.c memory.c errors.c",
+        { "tests_memory.c", "memory.c", "memory.h", "errors.c", "errors.h", NULL },
+        { NULL }
+    },
+    {
+        "PARSER", "tests_parser" EXE,
+        "gcc -o tests_parser tests_parser.c parser.c",
+        { "tests_parser.c", "parser.c", "parser.h", NULL },
+        { "parser_test1.txt", NULL }
+    },
+    {
+        "EXECUTOR", "tests_executor" EXE,
+        "gcc -o tests_executor tests_executor.c memory.c parser.c executor.c errors.c",
+        { "tests_executor.c", "memory.c", "memory.h", "parser.c", "parser.h",
+          "executor.c", "executor.h", "errors.c", "errors.h", NULL },
+        { "executor_basic.txt", "executor_incdec.txt", "executor_arith.txt",
+          "executor_andxor.txt", NULL }
+    },
+    {
+        "INTEGRATION", "tests_integration" EXE,
+        "gcc -o tests_integration tests_integration.c memory.c parser.c executor.c errors.c",
+        { "tests_integration.c", "memory.c", "memory.h", "parser.c", "parser.h",
+          "executor.c", "executor.h", "errors.c", "errors.h", NULL },
+        { "integration_basic.txt", "integration_print.txt", "executor_basic.txt", NULL }
+    },
+    {
+        "STRESS", "tests_memory_stress" EXE,
+        "gcc -o tests_memory_stress tests_memory_stress.c memory.c errors.c",
+        { "tests_memory_stress.c", "memory_capacity.h", "memory.c", "memory.h",
+          "errors.c", "errors.h", NULL },
+        { NULL }
+    },
+    {
+        "DIFFERENTIAL", "tests_differential" EXE,
+        "gcc -o tests_differential tests_differential.c memory.c parser.c executor.c errors.c",
+        { "tests_differential.c", "memory.c", "memory.h", "parser.c", "parser.h",
+          "executor.c", "executor.h", "errors.c", "errors.h", NULL },
+        { NULL }
+    },
+};
+
+#define WATCH_SUITE_COUNT ((int)(sizeof(watch_suites) / sizeof(watch_suites[0])))
+
+static int list_has(const char *const *list, const char *file) {
+    for (int i = 0; i < WATCH_MAX_FILES && list[i] != NULL; i++) {
+        if (strcmp(list[i], file) == 0) return 1;
+    }
+    return 0;
+}
+
+static void sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+// Marks which suites need a rebuild / rerun because of this file.
+// Returns 1 if the file is one we care about.
+static int mark_suites(const char *file, int *rebuild, int *rerun) {
+    int hit = 0;
+    for (int i = 0; i < WATCH_SUITE_COUNT; i++) {
+        if (list_has(watch_suites[i].sources, file)) {
+            rebuild[i] = 1;
+            rerun[i] = 1;
+            hit = 1;
+        } else if (list_has(watch_suites[i].programs, file)) {
+            rerun[i] = 1;
+            hit = 1;
+        }
+    }
+    return hit;
+}
+
+// Only use the Makefile if make is really there: plenty of Windows setups
+// have gcc but no make, and then every save would be a "BUILD FAILED".
+static int watch_can_use_make(void) {
+    static int checked = 0, usable = 0;
+    if (!checked) {
+        struct stat st;
+        checked = 1;
+#ifdef _WIN32
+        usable = stat("Makefile", &st) == 0 && system("make --version > NUL 2>&1") == 0;
+#else
+        usable = stat("Makefile", &st) == 0 && system("make --version > /dev/null 2>&1") == 0;
+#endif
+        printf("[watch] building with %s\n", usable ? "make" : "gcc (no make found)");
+    }
+    return usable;
+}
+
+static void run_marked_suites(const int *rebuild, const int *rerun) {
+    char command[256];
+    int passed = 0, failed = 0;
+    int use_make = watch_can_use_make();
+
+    for (int i = 0; i < WATCH_SUITE_COUNT; i++) {
+        if (!rerun[i]) continue;
+        const WatchSuite *suite = &watch_suites[i];
+
+        if (rebuild[i]) {
+            printf("[watch] building %s...\n", suite->binary);
+            fflush(stdout);
+            // with the Makefile only the changed .c files get recompiled
+            if (use_make) {
+                snprintf(command, sizeof(command), "make -s %s", suite->binary);
+            } else {
+                snprintf(command, sizeof(command), "%s", suite->build);
+            }
+            if (system(command) != 0) {
+                printf("[watch] %-12s BUILD FAILED\n", suite->name);
+                fflush(stdout);
+                failed++;
+                continue;
+            }
+        }
+
+        // send the suite's own chatter to a file so only our one line shows up,
+        // the full output is still there if something failed
+        snprintf(command, sizeof(command), "%s%s > watch_%s.log 2>&1",
+                 RUN_PREFIX, suite->binary, suite->binary);
+        int result = system(command);
+        if (result == 0) {
+            printf("[watch] %-12s PASSED\n", suite->name);
+            passed++;
+        } else {
+            printf("[watch] %-12s FAILED (see watch_%s.log)\n", suite->name, suite->binary);
+            failed++;
+        }
+        fflush(stdout);
+    }
+
+    printf("[watch] done: %d passed, %d failed. Waiting for changes...\n", passed, failed);
+    fflush(stdout);
+}
+
+// Every file any suite cares about, each one once.
+static int all_watched_files(const char **out, int max) {
+    int count = 0;
+    for (int i = 0; i < WATCH_SUITE_COUNT; i++) {
+        const char *const *lists[2] = { watch_suites[i].sources, watch_suites[i].programs };
+        for (int l = 0; l < 2; l++) {
+            for (int k = 0; k < WATCH_MAX_FILES && lists[l][k] != NULL; k++) {
+                int seen = 0;
+                for (int j = 0; j < count; j++) {
+                    if (strcmp(out[j], lists[l][k]) == 0) seen = 1;
+                }
+                if (!seen && count < max) out[count++] = lists[l][k];
+            }
+        }
+    }
+    return count;
+}
+
+int watch_mode(void) {
+    int rebuild[WATCH_SUITE_COUNT];
+    int rerun[WATCH_SUITE_COUNT];
+    const char *files[64];
+    int file_count = all_watched_files(files, 64);
+
+    printf("\n[watch] watching %d files, press Ctrl+C to stop\n", file_count);
+
+    // start with everything, so we know where we stand
+    for (int i = 0; i < WATCH_SUITE_COUNT; i++) {
+        rebuild[i] = 1;
+        rerun[i] = 1;
+    }
+    run_marked_suites(rebuild, rerun);
+
+#ifdef __linux__
+    int fd = inotify_init();
+    // watch the folder, not the files: editors often save by writing a new
+    // file and renaming it over the old one
+    int watching = fd >= 0 &&
+                   inotify_add_watch(fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0;
+    if (watching) {
+        // inotify(7): the events get read straight into this, so it needs their alignment
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        for (;;) {
+            ssize_t len = read(fd, buf, sizeof(buf));
+            if (len <= 0) break;
+
+            memset(rebuild, 0, sizeof(rebuild));
+            memset(rerun, 0, sizeof(rerun));
+            int hit = 0;
+
+            // an editor save can be a few events in a row, so keep reading
+            // until it's been quiet for a moment
+            for (;;) {
+                for (char *p = buf; p < buf + len; ) {
+                    struct inotify_event *ev = (struct inotify_event *)p;
+                    if (ev->len > 0 && mark_suites(ev->name, rebuild, rerun)) {
+                        printf("[watch] %s changed\n", ev->name);
+                        hit = 1;
+                    }
+                    p += sizeof(struct inotify_event) + ev->len;
+                }
+
+                fd_set set;
+                struct timeval quiet = { 0, 200000 };
+                FD_ZERO(&set);
+                FD_SET(fd, &set);
+                if (select(fd + 1, &set, NULL, NULL, &quiet) <= 0) break;
+                len = read(fd, buf, sizeof(buf));
+                if (len <= 0) break;
+            }
+
+            if (hit) {
+                run_marked_suites(rebuild, rerun);
+            }
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (watching) {
+        printf("[watch] lost the inotify watch, falling back to checking file times\n");
+    } else {
+        printf("[watch] couldn't set up inotify, falling back to checking file times\n");
+    }
+    fflush(stdout);
+#endif
+
+    // Polling: remember each file's last modified time and look again twice a second
+    time_t stamps[64];
+    struct stat st;
+    for (int i = 0; i < file_count; i++) {
+        stamps[i] = stat(files[i], &st) == 0 ? st.st_mtime : 0;
+    }
+
+    for (;;) {
+        sleep_ms(500);
+
+        memset(rebuild, 0, sizeof(rebuild));
+        memset(rerun, 0, sizeof(rerun));
+        int hit = 0;
+
+        for (int i = 0; i < file_count; i++) {
+            time_t now = stat(files[i], &st) == 0 ? st.st_mtime : 0;
+            if (now != stamps[i]) {
+                stamps[i] = now;
+                printf("[watch] %s changed\n", files[i]);
+                mark_suites(files[i], rebuild, rerun);
+                hit = 1;
+            }
+        }
+
+        if (hit) {
+            run_marked_suites(rebuild, rerun);
+        }
+    }
+
+    return 0;
 }
\ No newline at end of file
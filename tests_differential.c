@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memory.h"
+#include "parser.h"
+#include "executor.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Differential tests: we make up random programs, run them through the
+// real parse() + execute(), and also through a tiny "obviously right" model
+// of what every command should do. After EVERY command we compare all the
+// variables in the model with what var_get()/var_read_at() say. The first
+// time they disagree we print the whole program so you can replay it.
+//
+// Usage:
+//   tests_differential                       2000 programs, seed 1
+//   tests_differential 1000000 42            a million programs, seed 42
+//   tests_differential 1000000 42 --jobs 8   same, split over 8 processes
+//
+// The model only makes programs whose answer is clearly defined:
+//   * Mal only on a name that isn't in use, and never more than 100 cells
+//     in total over the whole program (so even an allocator that never
+//     reuses freed space can't run out)
+//   * Inc/Dec only on a cell that exists
+//   * And/Xor only between two variables of the same size
+//   * no command that would overflow an int (And/Xor included, they
+//     multiply/add each pair of cells before taking % 2)
+//   * no Pri/Pra, they don't change memory and would just spam the output
+
+void free_list(void);
+
+#define MODEL_CAPACITY 100
+#define MODEL_NAMES "abcdefgh"
+#define MODEL_NAME_COUNT 8
+#define MODEL_MAX_SIZE 8
+#define MAX_PROGRAM_LEN 40
+
+// These keep track of how many programs matched and how many didn't.
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+typedef enum {
+    M_MAL, M_ASS, M_INC, M_DEC, M_ADD, M_SUB, M_MUL, M_AND, M_XOR, M_FRE, M_KIND_COUNT
+} ModelOp;
+
+static const char *model_op_names[M_KIND_COUNT] = {
+    "Mal", "Ass", "Inc", "Dec", "Add", "Sub", "Mul", "And", "Xor", "Fre"
+};
+
+typedef struct {
+    ModelOp op;
+    char var1;
+    char var2;     // only for Add/Sub/Mul/And/Xor
+    int number;    // only for Mal/Ass/Inc/Dec
+} ModelCommand;
+
+typedef struct {
+    int live;
+    int size;
+    int cells[MODEL_MAX_SIZE];
+} ModelVar;
+
+// The reference model. One slot per name in MODEL_NAMES.
+static ModelVar model[MODEL_NAME_COUNT];
+static int model_cells_used_ever = 0;
+
+static ModelCommand program[MAX_PROGRAM_LEN];
+static int program_len = 0;
+
+static char program_path[64];
+
+// Small random number generator so every platform makes the same programs
+// for the same seed (rand() is different on Windows and Linux).
+static unsigned long long rng_state = 1;
+
+static unsigned int rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static int rng_below(int n) {
+    return (int)(rng_next() % (unsigned int)n);
+}
+
+static int name_index(char name) {
+    const char *p = strchr(MODEL_NAMES, name);
+    return p ? (int)(p - MODEL_NAMES) : -1;
+}
+
+static int fits_int(long long v) {
+    return v >= -2147483647LL - 1 && v <= 2147483647LL;
+}
+
+static void model_reset(void) {
+    memset(model, 0, sizeof(model));
+    model_cells_used_ever = 0;
+}
+
+// What each command is supposed to do, written as plainly as possible.
+static void model_step(const ModelCommand *c) {
+    ModelVar *x = &model[name_index(c->var1)];
+    ModelVar *y = c->var2 ? &model[name_index(c->var2)] : NULL;
+
+    switch (c->op) {
+        case M_MAL:
+            x->live = 1;
+            x->size = c->number;
+            memset(x->cells, 0, sizeof(x->cells));
+            model_cells_used_ever += c->number;
+            break;
+        case M_ASS:
+            x->cells[0] = c->number;
+            break;
+        case M_INC:
+            x->cells[c->number] += 1;
+            break;
+        case M_DEC:
+            x->cells[c->number] -= 1;
+            break;
+        case M_ADD:
+            x->cells[0] = x->cells[0] + y->cells[0];
+            break;
+        case M_SUB:
+            x->cells[0] = x->cells[0] - y->cells[0];
+            break;
+        case M_MUL:
+            x->cells[0] = x->cells[0] * y->cells[0];
+            break;
+        case M_AND:
+            for (int i = 0; i < x->size; i++) {
+                x->cells[i] = (x->cells[i] * y->cells[i]) % 2;
+            }
+            break;
+        case M_XOR:
+            for (int i = 0; i < x->size; i++) {
+                x->cells[i] = (x->cells[i] + y->cells[i]) % 2;
+            }
+            break;
+        case M_FRE:
+            x->live = 0;
+            x->size = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+static char random_live_name(void) {
+    int start = rng_below(MODEL_NAME_COUNT);
+    for (int k = 0; k < MODEL_NAME_COUNT; k++) {
+        int i = (start + k) % MODEL_NAME_COUNT;
+        if (model[i].live) return MODEL_NAMES[i];
+    }
+    return 0;
+}
+
+static char random_free_name(void) {
+    int start = rng_below(MODEL_NAME_COUNT);
+    for (int k = 0; k < MODEL_NAME_COUNT; k++) {
+        int i = (start + k) % MODEL_NAME_COUNT;
+        if (!model[i].live) return MODEL_NAMES[i];
+    }
+    return 0;
+}
+
+static char random_live_name_with_size(int size) {
+    int start = rng_below(MODEL_NAME_COUNT);
+    for (int k = 0; k < MODEL_NAME_COUNT; k++) {
+        int i = (start + k) % MODEL_NAME_COUNT;
+        if (model[i].live && model[i].size == size) return MODEL_NAMES[i];
+    }
+    return 0;
+}
+
+// Tries to make one random command that is allowed right now.
+// Returns 0 if the kind it picked doesn't make sense yet (caller retries).
+static int random_command(ModelCommand *c) {
+    memset(c, 0, sizeof(*c));
+    c->op = (ModelOp)rng_below(M_KIND_COUNT);
+
+    if (c->op == M_MAL) {
+        int size = 1 + rng_below(MODEL_MAX_SIZE);
+        c->var1 = random_free_name();
+        c->number = size;
+        return c->var1 && model_cells_used_ever + size <= MODEL_CAPACITY;
+    }
+
+    c->var1 = random_live_name();
+    if (!c->var1) return 0;
+    ModelVar *x = &model[name_index(c->var1)];
+
+    switch (c->op) {
+        case M_ASS:
+            c->number = rng_below(201) - 100;
+            return 1;
+        case M_INC:
+        case M_DEC: {
+            c->number = rng_below(x->size);
+            long long next = (long long)x->cells[c->number] + (c->op == M_INC ? 1 : -1);
+            return fits_int(next);
+        }
+        case M_ADD:
+        case M_SUB:
+        case M_MUL: {
+            c->var2 = random_live_name();
+            ModelVar *y = &model[name_index(c->var2)];
+            long long a = x->cells[0], b = y->cells[0];
+            long long r = c->op == M_ADD ? a + b : c->op == M_SUB ? a - b : a * b;
+            return fits_int(r);
+        }
+        case M_AND:
+        case M_XOR: {
+            c->var2 = random_live_name_with_size(x->size);
+            if (!c->var2) return 0;
+            // And multiplies and Xor adds every pair of cells before the % 2
+            ModelVar *y = &model[name_index(c->var2)];
+            for (int i = 0; i < x->size; i++) {
+                long long a = x->cells[i], b = y->cells[i];
+                if (!fits_int(c->op == M_AND ? a * b : a + b)) return 0;
+            }
+            return 1;
+        }
+        case M_FRE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void make_random_program(void) {
+    model_reset();
+    program_len = 1 + rng_below(MAX_PROGRAM_LEN);
+
+    for (int i = 0; i < program_len; i++) {
+        ModelCommand c;
+        int tries = 0;
+        while (!random_command(&c)) {
+            // nothing is alive yet and we rolled Mal with no room left:
+            // just stop the program early
+            if (++tries > 100) {
+                program_len = i;
+                model_reset();
+                return;
+            }
+        }
+        program[i] = c;
+        model_step(&c);
+    }
+    model_reset();
+}
+
+static void print_command(const ModelCommand *c) {
+    if (c->var2) {
+        printf("%s %c %c", model_op_names[c->op], c->var1, c->var2);
+    } else if (c->op == M_FRE) {
+        printf("%s %c", model_op_names[c->op], c->var1);
+    } else {
+        printf("%s %c %d", model_op_names[c->op], c->var1, c->number);
+    }
+}
+
+static int write_program(void) {
+    FILE *f = fopen(program_path, "w");
+    if (!f) {
+        printf("ERROR: Could not create %s\n", program_path);
+        return 0;
+    }
+    for (int i = 0; i < program_len; i++) {
+        const ModelCommand *c = &program[i];
+        if (c->var2) {
+            fprintf(f, "%s %c %c\n", model_op_names[c->op], c->var1, c->var2);
+        } else if (c->op == M_FRE) {
+            fprintf(f, "%s %c\n", model_op_names[c->op], c->var1);
+        } else {
+            fprintf(f, "%s %c %d\n", model_op_names[c->op], c->var1, c->number);
+        }
+    }
+    fclose(f);
+    return 1;
+}
+
+static void report_mismatch(int step, const char *what) {
+    printf("FAIL: real interpreter and model disagree after command %d: %s\n", step, what);
+    printf("  Program:\n");
+    for (int i = 0; i < program_len; i++) {
+        printf("  %s %2d: ", i == step ? "->" : "  ", i);
+        print_command(&program[i]);
+        printf("\n");
+    }
+}
+
+// Compares every name the model knows about with the real memory.
+static int compare_state(int step) {
+    char what[160];
+
+    for (int n = 0; n < MODEL_NAME_COUNT; n++) {
+        char name = MODEL_NAMES[n];
+        const ModelVar *m = &model[n];
+        Variable v = var_get(name);
+
+        if (!m->live) {
+            if (v != NULL) {
+                snprintf(what, sizeof(what), "%c should not exist", name);
+                report_mismatch(step, what);
+                return 0;
+            }
+            continue;
+        }
+
+        if (v == NULL) {
+            snprintf(what, sizeof(what), "%c should exist", name);
+            report_mismatch(step, what);
+            return 0;
+        }
+        if (var_size(v) != m->size) {
+            snprintf(what, sizeof(what), "%c should have size %d, got %d",
+                     name, m->size, var_size(v));
+            report_mismatch(step, what);
+            return 0;
+        }
+        for (int i = 0; i < m->size; i++) {
+            int real = var_read_at(v, i);
+            if (real != m->cells[i]) {
+                snprintf(what, sizeof(what), "%c[%d] should be %d, got %d",
+                         name, i, m->cells[i], real);
+                report_mismatch(step, what);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Runs one program through both and returns 1 if they agreed the whole way.
+static int run_one_program(void) {
+    make_random_program();
+    if (program_len == 0) return 1;
+    if (!write_program()) return 0;
+
+    memory_init();
+    int count = parse(program_path);
+    if (count != program_len) {
+        char what[80];
+        snprintf(what, sizeof(what), "parse gave %d commands, wanted %d", count, program_len);
+        report_mismatch(0, what);
+        free_list();
+        return 0;
+    }
+
+    model_reset();
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++) {
+        execute(i);
+        model_step(&program[i]);
+        ok = compare_state(i);
+    }
+
+    free_list();
+    return ok;
+}
+
+// Runs a share of the programs. We stop after a handful of failures,
+// one bad program is usually enough to find the bug.
+static void run_programs(long count, unsigned long long seed) {
+    rng_state = seed ? seed : 1;
+    snprintf(program_path, sizeof(program_path), "test_differential_%d.txt", (int)getpid());
+
+    for (long p = 0; p < count && tests_failed < 5; p++) {
+        if (run_one_program()) {
+            tests_passed++;
+        } else {
+            tests_failed++;
+        }
+    }
+
+    remove(program_path);
+}
+
+int main(int argc, char **argv) {
+    long count = 2000;
+    unsigned long long seed = 1;
+    int workers = 1;
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1) workers = 1;
+        } else if (positional == 0) {
+            count = atol(argv[i]);
+            positional++;
+        } else {
+            seed = strtoull(argv[i], NULL, 10);
+        }
+    }
+
+    printf("\n========================================\n");
+    printf("        DIFFERENTIAL TEST SUITE\n");
+    printf("========================================\n");
+    printf("Programs: %ld  Seed: %llu  Jobs: %d\n", count, seed, workers);
+
+#ifdef _WIN32
+    workers = 1;
+#endif
+
+    if (workers == 1) {
+        run_programs(count, seed);
+        printf("\nDifferential programs matched: %d\n", tests_passed);
+        printf("Differential programs failed:  %d\n", tests_failed);
+        return (tests_failed == 0) ? 0 : 1;
+    }
+
+#ifndef _WIN32
+    // Every worker gets its own seed and its own slice of the programs.
+    // The globals in memory.c etc. are per process, so they can't clash.
+    fflush(stdout);
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            long share = count / workers + (w < count % workers ? 1 : 0);
+            run_programs(share, seed * 1000003ULL + (unsigned long long)w);
+            printf("  worker %d: %d matched, %d failed\n", w, tests_passed, tests_failed);
+            fflush(stdout);
+            // exit(), not _exit(), so profiling data gets written for this worker too
+            exit(tests_failed == 0 ? 0 : 1);
+        }
+    }
+
+    int bad_workers = 0;
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            bad_workers++;
+        }
+    }
+
+    printf("\nDifferential workers failed: %d of %d\n", bad_workers, workers);
+    return (bad_workers == 0) ? 0 : 1;
+#endif
+}
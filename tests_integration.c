@@ -5,6 +5,10 @@
 #include "parser.h"
 #include "executor.h"
 
+#ifdef ALLOC_TRACK
+#include "alloc_track.h"
+#endif
+
 // Test tracking variables
 static int tests_passed = 0;
 static int tests_failed = 0;
@@ -243,6 +247,40 @@ void test_integration_complete_program(void) {
     free_list();
 }
 
+#ifdef ALLOC_TRACK
+// TEST 7: Running the same program again and again shouldn't make the heap grow
+// (only when built with make BUILD=track, which counts the interpreter's mallocs)
+void test_integration_no_heap_growth(void) {
+    current_test_name = "Heap doesn't grow across repeated runs";
+    printf("\nRunning: %s\n", current_test_name);
+
+    long after_run[3];
+    for (int run = 0; run < 3; run++) {
+        alloc_track_set_phase(ALLOC_PHASE_OTHER);
+        memory_init();
+        alloc_track_set_phase(ALLOC_PHASE_PARSE);
+        int count = parse("integration_basic.txt");
+        alloc_track_set_phase(ALLOC_PHASE_EXECUTE);
+        for (int i = 0; i < count; i++) {
+            execute(i);
+        }
+        alloc_track_set_phase(ALLOC_PHASE_TEARDOWN);
+        free_list();
+        alloc_track_set_phase(ALLOC_PHASE_OTHER);
+        after_run[run] = alloc_track_live_bytes();
+    }
+
+    // the first run may set up things that stick around on purpose,
+    // but after that every run should give back everything it took
+    assert_eq_int((int)after_run[1], (int)after_run[2],
+                  "live heap bytes should be the same after run 2 and run 3");
+
+    printf("  Heap after each run: %ld, %ld, %ld bytes\n",
+           after_run[0], after_run[1], after_run[2]);
+    alloc_track_report(stdout);
+}
+#endif
+
 int main(void) {
     printf("\n========================================\n");
     printf("        INTEGRATION TEST SUITE\n");
@@ -255,6 +293,9 @@ int main(void) {
     test_integration_error_handling();
     test_integration_with_existing_files();
     test_integration_complete_program();
+#ifdef ALLOC_TRACK
+    test_integration_no_heap_growth();
+#endif
     
     printf("\n========================================\n");
     printf("INTEGRATION TEST RESULTS:\n");
@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "memory.h"
+#include "memory_capacity.h"
+
+// Random stress test for the Main_Array allocator.
+//
+// We do long random runs of var_allocate / var_free / var_write_at and keep
+// our own copy ("shadow") of what every variable should hold. After every
+// single step we check:
+//   * every live variable still has exactly the values we wrote
+//     (if two variables overlap, one of them gets clobbered and we see it)
+//   * a freshly allocated variable is all zeros
+//   * we never get more cells than the memory has (free + used == capacity,
+//     so used can never go over capacity)
+//   * freed names are really gone
+// and at the end of every run we free everything and check the whole
+// capacity can be allocated again in one go (the free list put it all back).
+//
+// When a run fails we shrink it: keep throwing away steps while it still
+// fails, then print the few steps that are left so you can turn it into
+// a normal test.
+//
+// At the end it also times a run without any checking, so you can see how
+// many allocator operations per second your memory.c does.
+//
+// Usage:
+//   tests_memory_stress                 2000 runs of 200 steps, seed 1
+//   tests_memory_stress 20000 42        20000 runs, seed 42
+//   tests_memory_stress --capacity 100  check against a Main_Array of 100 cells
+//
+// memory.h doesn't say how many cells Main_Array has. Give it with
+// --capacity N or build with -DMEMORY_CAPACITY=N. Without either we find out
+// at startup (see memory_capacity.h). If var_allocate never says no, the
+// capacity checks are skipped.
+#define STRESS_NAMES "abcdefghijklmnopqrstuvwxyz"
+#define STRESS_NAME_COUNT 26
+#define STRESS_MAX_SIZE 20
+#define STRESS_STEPS 200
+#define FULL_NAME 'Z'   // only used for the "whole capacity" check at the end
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+static int capacity = MEMORY_CAPACITY;   // 0 = unknown, the checks that need it are skipped
+
+typedef enum { OP_ALLOC, OP_FREE, OP_WRITE } StressOpKind;
+
+typedef struct {
+    StressOpKind kind;
+    char name;
+    int size;      // OP_ALLOC
+    int index;     // OP_WRITE (taken modulo the size when we run it)
+    int value;     // OP_WRITE
+} StressOp;
+
+typedef struct {
+    int live;
+    int size;
+    int cells[STRESS_MAX_SIZE];
+} Shadow;
+
+static Shadow shadow[STRESS_NAME_COUNT];
+static int cells_used = 0;
+static long fragmentation_misses = 0;   // alloc said no while there was room in total
+
+static char failure[200];
+
+// Same numbers on every platform for the same seed
+static unsigned long long rng_state = 1;
+
+static unsigned int rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (unsigned int)(rng_state >> 16);
+}
+
+static int rng_below(int n) {
+    return (int)(rng_next() % (unsigned int)n);
+}
+
+static StressOp random_op(void) {
+    StressOp op;
+    int roll = rng_below(10);
+    op.kind = roll < 3 ? OP_ALLOC : roll < 5 ? OP_FREE : OP_WRITE;
+    op.name = STRESS_NAMES[rng_below(STRESS_NAME_COUNT)];
+    op.size = 1 + rng_below(STRESS_MAX_SIZE);
+    op.index = rng_below(STRESS_MAX_SIZE);
+    op.value = (int)(rng_next() % 2000001u) - 1000000;   // -1000000..1000000
+    return op;
+}
+
+static void shadow_reset(void) {
+    memset(shadow, 0, sizeof(shadow));
+    cells_used = 0;
+}
+
+// Checks every live variable against the shadow copy.
+static int check_all(void) {
+    for (int n = 0; n < STRESS_NAME_COUNT; n++) {
+        char name = STRESS_NAMES[n];
+        const Shadow *s = &shadow[n];
+        Variable v = var_get(name);
+
+        if (!s->live) {
+            if (v != NULL || var_exists(name)) {
+                snprintf(failure, sizeof(failure), "%c should not exist", name);
+                return 0;
+            }
+            continue;
+        }
+        if (v == NULL || !var_exists(name)) {
+            snprintf(failure, sizeof(failure), "%c should exist", name);
+            return 0;
+        }
+        if (var_size(v) != s->size) {
+            snprintf(failure, sizeof(failure), "%c should have size %d, got %d",
+                     name, s->size, var_size(v));
+            return 0;
+        }
+        for (int i = 0; i < s->size; i++) {
+            int real = var_read_at(v, i);
+            if (real != s->cells[i]) {
+                snprintf(failure, sizeof(failure),
+                         "%c[%d] should be %d, got %d (overlapping another variable?)",
+                         name, i, s->cells[i], real);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Does one step for real and on the shadow. Steps that don't make sense
+// right now (free of a name that isn't there, etc) are skipped, so a
+// shrunk run still means something. Returns 0 if an invariant broke.
+static int apply(const StressOp *op) {
+    Shadow *s = &shadow[op->name - 'a'];
+
+    switch (op->kind) {
+        case OP_ALLOC: {
+            if (s->live) return 1;
+            int ok = var_allocate(op->name, op->size);
+            if (!ok) {
+                if (capacity > 0 && cells_used + op->size <= capacity) {
+                    fragmentation_misses++;
+                }
+                return check_all();
+            }
+            if (capacity > 0 && cells_used + op->size > capacity) {
+                snprintf(failure, sizeof(failure),
+                         "alloc %c (size %d) worked but only %d of %d cells were free",
+                         op->name, op->size, capacity - cells_used, capacity);
+                return 0;
+            }
+            Variable v = var_get(op->name);
+            for (int i = 0; v != NULL && i < op->size; i++) {
+                if (var_read_at(v, i) != 0) {
+                    snprintf(failure, sizeof(failure),
+                             "fresh %c[%d] should be 0, got %d", op->name, i, var_read_at(v, i));
+                    return 0;
+                }
+            }
+            s->live = 1;
+            s->size = op->size;
+            memset(s->cells, 0, sizeof(s->cells));
+            cells_used += op->size;
+            break;
+        }
+        case OP_FREE:
+            if (!s->live) return 1;
+            if (var_free(op->name) != 1) {
+                snprintf(failure, sizeof(failure), "freeing live %c should return 1", op->name);
+                return 0;
+            }
+            s->live = 0;
+            cells_used -= s->size;
+            break;
+        case OP_WRITE: {
+            if (!s->live) return 1;
+            int index = op->index % s->size;
+            var_write_at(var_get(op->name), index, op->value);
+            s->cells[index] = op->value;
+            break;
+        }
+    }
+    return check_all();
+}
+
+// After a run: free everything and ask for the whole memory in one piece.
+static int check_full_capacity(void) {
+    for (int n = 0; n < STRESS_NAME_COUNT; n++) {
+        if (shadow[n].live) {
+            var_free(STRESS_NAMES[n]);
+            shadow[n].live = 0;
+        }
+    }
+    cells_used = 0;
+    if (capacity == 0) return 1;
+
+    if (var_allocate(FULL_NAME, capacity) != 1) {
+        snprintf(failure, sizeof(failure),
+                 "after freeing everything, alloc of all %d cells should work", capacity);
+        return 0;
+    }
+    Variable v = var_get(FULL_NAME);
+    for (int i = 0; v != NULL && i < capacity; i++) {
+        if (var_read_at(v, i) != 0) {
+            snprintf(failure, sizeof(failure),
+                     "whole-memory alloc should be all zeros, cell %d is %d", i, var_read_at(v, i));
+            var_free(FULL_NAME);
+            return 0;
+        }
+    }
+    var_free(FULL_NAME);
+    return 1;
+}
+
+// Runs ops[i] for every i where keep[i] is set, from a clean memory.
+// Returns the step it failed at, len if only the final check failed, or -1 if all good.
+static int replay(const StressOp *ops, const char *keep, int len) {
+    memory_init();
+    shadow_reset();
+    for (int i = 0; i < len; i++) {
+        if (keep && !keep[i]) continue;
+        if (!apply(&ops[i])) {
+            free_list();
+            return i;
+        }
+    }
+    int ok = check_full_capacity();
+    free_list();
+    return ok ? -1 : len;
+}
+
+static void print_op(const StressOp *op) {
+    switch (op->kind) {
+        case OP_ALLOC:
+            printf("var_allocate('%c', %d)", op->name, op->size);
+            break;
+        case OP_FREE:
+            printf("var_free('%c')", op->name);
+            break;
+        case OP_WRITE:
+            printf("var_write_at(var_get('%c'), %d %% size, %d)", op->name, op->index, op->value);
+            break;
+    }
+}
+
+// Throws away chunks of steps (big chunks first, then smaller) as long as
+// the run still fails, then prints what's left.
+static void shrink_and_report(const StressOp *ops, int len) {
+    char keep[STRESS_STEPS];
+    memset(keep, 1, sizeof(keep));
+
+    for (int chunk = len / 2; chunk >= 1; chunk /= 2) {
+        int changed = 1;
+        while (changed) {
+            changed = 0;
+            for (int start = 0; start < len; start += chunk) {
+                char saved[STRESS_STEPS];
+                memcpy(saved, keep, sizeof(keep));
+                int dropped = 0;
+                for (int i = start; i < start + chunk && i < len; i++) {
+                    if (keep[i]) {
+                        keep[i] = 0;
+                        dropped++;
+                    }
+                }
+                if (dropped == 0) continue;
+                if (replay(ops, keep, len) >= 0) {
+                    changed = 1;
+                } else {
+                    memcpy(keep, saved, sizeof(keep));
+                }
+            }
+        }
+    }
+
+    int at = replay(ops, keep, len);
+    int kept = 0;
+    for (int i = 0; i < len; i++) kept += keep[i];
+
+    printf("FAIL: %s\n", failure);
+    printf("  Smallest run that still fails (%d of %d steps), starting from memory_init():\n",
+           kept, len);
+    for (int i = 0; i < len; i++) {
+        if (!keep[i]) continue;
+        printf("  %s ", i == at ? "->" : "  ");
+        print_op(&ops[i]);
+        printf("\n");
+    }
+    if (at == len) {
+        printf("  -> then free everything and var_allocate('%c', %d)\n", FULL_NAME, capacity);
+    }
+}
+
+static double seconds_now(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// No checking here, just hammering the allocator to see how fast it is.
+static void soak(long steps) {
+    int live[STRESS_NAME_COUNT] = {0};
+
+    memory_init();
+    double start = seconds_now();
+    for (long i = 0; i < steps; i++) {
+        StressOp op = random_op();
+        int n = op.name - 'a';
+        if (op.kind == OP_ALLOC && !live[n]) {
+            live[n] = var_allocate(op.name, op.size);
+        } else if (op.kind == OP_FREE && live[n]) {
+            var_free(op.name);
+            live[n] = 0;
+        } else if (live[n]) {
+            Variable v = var_get(op.name);
+            var_write_at(v, op.index % var_size(v), op.value);
+        }
+    }
+    double secs = seconds_now() - start;
+    free_list();
+
+    printf("\nAllocator soak: %ld steps in %.3f s", steps, secs);
+    if (secs > 0) {
+        printf(" (%.0f ops/sec, %.1f ns/op)", steps / secs, secs * 1e9 / steps);
+    }
+    printf("\n");
+    if (secs > 0) {
+        // lower is better; perf_gate reads this
+        printf("BENCH memory.soak_ns_per_op %.3f\n", secs * 1e9 / steps);
+    }
+}
+
+int main(int argc, char **argv) {
+    long runs = 2000;
+    unsigned long long seed = 1;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = atoi(argv[++i]);
+        } else if (positional == 0) {
+            runs = atol(argv[i]);
+            positional++;
+        } else {
+            seed = strtoull(argv[i], NULL, 10);
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    printf("\n========================================\n");
+    printf("       MEMORY STRESS TEST SUITE\n");
+    printf("========================================\n");
+    printf("Runs: %ld x %d steps  Seed: %llu\n", runs, STRESS_STEPS, seed);
+    if (capacity > 0) {
+        printf("Capacity: %d cells (given)\n", capacity);
+    } else {
+        capacity = memory_capacity(FULL_NAME);
+        if (capacity > 0) {
+            printf("Capacity: %d cells (the biggest block var_allocate gave out;\n"
+                   "          use --capacity N if that isn't the real size)\n", capacity);
+        } else {
+            printf("Capacity: unknown (var_allocate never said no), skipping the capacity checks\n");
+        }
+    }
+
+    StressOp ops[STRESS_STEPS];
+    double start = seconds_now();
+
+    for (long r = 0; r < runs && tests_failed < 3; r++) {
+        for (int i = 0; i < STRESS_STEPS; i++) {
+            ops[i] = random_op();
+        }
+        if (replay(ops, NULL, STRESS_STEPS) < 0) {
+            tests_passed++;
+        } else {
+            tests_failed++;
+            shrink_and_report(ops, STRESS_STEPS);
+        }
+    }
+
+    double secs = seconds_now() - start;
+    long steps = (long)(tests_passed + tests_failed) * STRESS_STEPS;
+    printf("\nChecked %ld steps in %.3f s", steps, secs);
+    if (secs > 0) {
+        printf(" (%.0f checked steps/sec)", steps / secs);
+    }
+    printf("\n");
+    printf("Allocs refused while enough cells were free (fragmentation): %ld\n",
+           fragmentation_misses);
+
+    soak(runs * STRESS_STEPS);
+
+    printf("\nMemory stress runs passed: %d\n", tests_passed);
+    printf("Memory stress runs failed: %d\n", tests_failed);
+
+    return (tests_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace_format.h"
+
+// Turns a run_batch trace (RUN_BATCH_TRACE=prefix -> prefix.<worker>.bin)
+// into something a person can read.
+//
+// Usage:
+//   trace_decode trace.0.bin            one line per command
+//   trace_decode trace.0.bin --chrome   Chrome trace-event JSON
+//                                       (open it in chrome://tracing or Perfetto)
+
+static char **job_paths = NULL;
+static uint32_t job_count = 0;
+
+static int read_exact(FILE *f, void *buf, size_t len) {
+    return fread(buf, 1, len, f) == len;
+}
+
+static const char *job_name(int32_t job) {
+    if (job < 0 || (uint32_t)job >= job_count || job_paths[job] == NULL) return "?";
+    return job_paths[job];
+}
+
+// var2 is 0 for commands that only have one variable
+static void format_operands(const TraceRecord *r, char *out, size_t out_len) {
+    if (r->var2 >= 33 && r->var2 < 127) {
+        snprintf(out, out_len, "%c %c", r->var1, r->var2);
+    } else {
+        snprintf(out, out_len, "%c %d", r->var1, r->number);
+    }
+}
+
+// Paths can have \ in them (Windows) and names can be " or \ too
+static void print_json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') {
+            printf("\\%c", ch);
+        } else if (ch < 0x20) {
+            printf("\\u%04x", ch);
+        } else {
+            putchar(ch);
+        }
+    }
+    putchar('"');
+}
+
+static void print_text(const TraceRecord *r, uint64_t t0) {
+    char operands[32];
+    format_operands(r, operands, sizeof(operands));
+    printf("%12.3f us  %-24s #%-4d op %-2d %s",
+           (r->timestamp_ns - t0) / 1e3, job_name(r->job), r->command, r->op, operands);
+
+    if (r->cell == -1) {
+        printf("  size %d -> %d", r->old_value, r->new_value);
+    } else if (r->cell >= 0) {
+        printf("  %c[%d] %d -> %d", r->var1, r->cell, r->old_value, r->new_value);
+    } else if (r->cell == -2) {
+        printf("  (no change)");
+    }
+    printf("  (%u ns)\n", r->duration_ns);
+}
+
+static void print_chrome(const TraceRecord *r, uint64_t t0, int first) {
+    // one "complete" event per command, one row (tid) per program
+    char name[48];
+    char operands[32];
+    format_operands(r, operands, sizeof(operands));
+    snprintf(name, sizeof(name), "op %d %s", r->op, operands);
+
+    printf("%s\n    {\"name\": ", first ? "" : ",");
+    print_json_string(name);
+    printf(", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, ",
+           r->job, (r->timestamp_ns - t0) / 1e3, r->duration_ns / 1e3);
+    printf("\"args\": {\"program\": ");
+    print_json_string(job_name(r->job));
+    printf(", \"command\": %d, \"cell\": %d, \"old\": %d, \"new\": %d}}",
+           r->command, r->cell, r->old_value, r->new_value);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    int chrome = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--chrome") == 0) {
+            chrome = 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (!path) {
+        printf("Usage: trace_decode <trace.bin> [--chrome]\n");
+        return 2;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("ERROR: Could not open %s\n", path);
+        return 2;
+    }
+
+    char magic[4];
+    uint32_t version;
+    if (!read_exact(f, magic, 4) || memcmp(magic, TRACE_MAGIC, 4) != 0 ||
+        !read_exact(f, &version, sizeof(version))) {
+        printf("ERROR: %s is not a trace file\n", path);
+        fclose(f);
+        return 2;
+    }
+    if (version != TRACE_VERSION) {
+        printf("ERROR: %s is trace version %u, we only know %d\n",
+               path, version, TRACE_VERSION);
+        fclose(f);
+        return 2;
+    }
+
+    if (!read_exact(f, &job_count, sizeof(job_count))) {
+        printf("ERROR: %s is cut short\n", path);
+        fclose(f);
+        return 2;
+    }
+    job_paths = calloc(job_count ? job_count : 1, sizeof(char *));
+    for (uint32_t j = 0; j < job_count; j++) {
+        uint16_t len;
+        if (!read_exact(f, &len, sizeof(len))) break;   // the rest stay NULL, shown as "?"
+        job_paths[j] = malloc(len + 1u);
+        if (!read_exact(f, job_paths[j], len)) len = 0;
+        job_paths[j][len] = '\0';
+    }
+
+    uint64_t total_written = 0;
+    uint32_t stored = 0;
+    if (!read_exact(f, &total_written, sizeof(total_written)) ||
+        !read_exact(f, &stored, sizeof(stored))) {
+        printf("ERROR: %s is cut short\n", path);
+        fclose(f);
+        return 2;
+    }
+
+    TraceRecord r;
+    uint64_t t0 = 0;
+    int first = 1;
+
+    if (chrome) {
+        printf("{\"traceEvents\": [");
+    } else {
+        printf("%s: %u commands", path, stored);
+        if (total_written > stored) {
+            printf(" (oldest %llu were overwritten in the ring)",
+                   (unsigned long long)(total_written - stored));
+        }
+        printf("\n");
+    }
+
+    for (uint32_t k = 0; k < stored; k++) {
+        if (!read_exact(f, &r, sizeof(r))) {
+            fprintf(stderr, "WARNING: %s ends after %u of %u records\n", path, k, stored);
+            break;
+        }
+        if (first) t0 = r.timestamp_ns;
+        if (chrome) {
+            print_chrome(&r, t0, first);
+        } else {
+            print_text(&r, t0);
+        }
+        first = 0;
+    }
+
+    if (chrome) {
+        printf("\n]}\n");
+    }
+
+    fclose(f);
+    for (uint32_t j = 0; j < job_count; j++) {
+        free(job_paths[j]);
+    }
+    free(job_paths);
+    return 0;
+}
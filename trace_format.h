@@ -0,0 +1,39 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+
+// Binary trace written by run_batch (RUN_BATCH_TRACE) and read by trace_decode.
+//
+// File layout:
+//   char     magic[4]        "WMTR"
+//   uint32_t version         TRACE_VERSION
+//   uint32_t job_count
+//   job_count times:  uint16_t length, then that many bytes of program path
+//   uint64_t total_written   how many records were ever put in the ring
+//   uint32_t stored          how many are in the file (oldest first)
+//   stored times:     TraceRecord
+//
+// Everything is written in the byte order of the machine that made it.
+
+#define TRACE_MAGIC "WMTR"
+#define TRACE_VERSION 2
+#define TRACE_RING_RECORDS 65536   // per worker, oldest records get overwritten
+
+typedef struct {
+    uint64_t timestamp_ns;   // when the previous command in this program ended (or the program started)
+    uint32_t duration_ns;    // execute() plus the tracing work around it, up to the next timestamp
+    int32_t job;             // which program (index into the job list)
+    int32_t command;         // which command in that program
+    int32_t op;              // cmd_get_op(), i.e. the position in the command enum in parser.h
+    int32_t number;          // cmd_get_number()
+    int32_t cell;            // first cell that changed, -1 if the variable was made/freed/resized, -2 if nothing changed,
+                             // -3 if the cells weren't looked at (the program passed, see run_batch.c)
+    int32_t old_value;       // old cell value (or old size when cell == -1)
+    int32_t new_value;       // new cell value (or new size when cell == -1)
+    char var1;
+    char var2;
+    char pad[6];             // always 0; spelled out so no uninitialized padding ends up in the file
+} TraceRecord;             // 48 bytes
+
+#endif
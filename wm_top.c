@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "live_format.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Like top, but for a run_batch that was started with RUN_BATCH_LIVE set.
+// Shows for every worker which program and command it is on, commands/sec,
+// how full Main_Array is, the live variables, and how often Mal was refused
+// even though enough cells were free in total (fragmentation).
+//
+// Usage:
+//   wm_top                      attach to the default (RUN_BATCH_LIVE=1)
+//   wm_top /name                attach to RUN_BATCH_LIVE=name
+//   wm_top /name --interval 500 refresh every 500 ms (default 1000)
+//   wm_top /name --once         print one snapshot and quit
+//
+// It only reads the shared memory, so it never slows the workers down
+// (see live_format.h for how it gets a consistent copy without locks).
+
+#ifdef _WIN32
+int main(void) {
+    printf("wm_top needs POSIX shared memory, it doesn't work on Windows\n");
+    return 2;
+}
+#else
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Seqlock read side: copy the slot, and keep trying until nobody was
+// writing it while we copied. A worker that got killed halfway through a
+// write leaves seq odd forever, so after enough tries we take what's there.
+static void read_worker(const LiveWorker *shared, LiveWorker *copy) {
+    for (int tries = 0; tries < 100000; tries++) {
+        uint32_t before = __atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        memcpy(copy, (const void *)shared, sizeof(*copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t after = __atomic_load_n(&shared->seq, __ATOMIC_RELAXED);
+        if (before == after) return;
+    }
+    memcpy(copy, (const void *)shared, sizeof(*copy));
+}
+
+static void print_screen(const LiveHeader *h, const LiveWorker *now,
+                         const LiveWorker *last, double secs, int clear) {
+    uint64_t commands = 0, programs = 0, refused = 0, fragmented = 0;
+    uint64_t ops[LIVE_MAX_OPS] = {0};
+    double rate = 0.0;
+    int busy = 0;
+
+    for (int w = 0; w < h->workers; w++) {
+        commands += now[w].commands_done;
+        programs += now[w].programs_done;
+        refused += now[w].mal_refused;
+        fragmented += now[w].mal_fragmented;
+        for (int o = 0; o < LIVE_MAX_OPS; o++) ops[o] += now[w].op_counts[o];
+        if (secs > 0) rate += (now[w].commands_done - last[w].commands_done) / secs;
+        if (!now[w].finished) busy++;
+    }
+
+    if (clear) printf("\033[H\033[J");
+    printf("wm_top - %s  %.1f s  workers %d/%d busy  %s\n", h->source,
+           (now_ns() - h->start_ns) / 1e9, busy, h->workers,
+           h->finished ? "FINISHED" : "running");
+    printf("Programs: %llu/%d  Commands: %llu  Commands/sec: %.0f\n",
+           (unsigned long long)programs, h->job_count, (unsigned long long)commands, rate);
+    if (h->capacity > 0) {
+        printf("Mal refused: %llu  (with enough cells free in total: %llu)\n\n",
+               (unsigned long long)refused, (unsigned long long)fragmented);
+    } else {
+        printf("Mal refused: %llu  (Main_Array size unknown, can't tell how many were fragmentation)\n\n",
+               (unsigned long long)refused);
+    }
+
+    printf("%-4s %-7s %-6s %-7s %-3s %11s %9s %-9s %s\n",
+           "WKR", "PID", "PROG", "CMD", "OP", "CMDS/SEC", "CELLS", "LARGEST", "LIVE VARS");
+    for (int w = 0; w < h->workers; w++) {
+        const LiveWorker *n = &now[w];
+        double wrate = secs > 0 ? (n->commands_done - last[w].commands_done) / secs : 0.0;
+        if (n->finished) {
+            printf("%-4d %-7d done (%llu programs)\n", w, n->pid,
+                   (unsigned long long)n->programs_done);
+        } else if (n->job < 0) {
+            printf("%-4d %-7d %-6s %-7s %-3s %11.0f\n", w, n->pid, "-", "-", "-", wrate);
+        } else {
+            char cells[24];
+            if (h->capacity > 0) {
+                snprintf(cells, sizeof(cells), "%5d/%-3d", n->cells_used, h->capacity);
+            } else {
+                snprintf(cells, sizeof(cells), "%5d/?  ", n->cells_used);
+            }
+            printf("%-4d %-7d %-6d %-7d %-3d %11.0f %s %-9d %s\n",
+                   w, n->pid, n->job, n->command, n->op, wrate,
+                   cells, n->largest_var, n->live_vars);
+        }
+    }
+
+    printf("\nCommands per op:");
+    for (int o = 0; o < LIVE_MAX_OPS; o++) {
+        if (ops[o] > 0) printf("  %d:%llu", o, (unsigned long long)ops[o]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    const char *name = LIVE_DEFAULT_NAME;
+    int interval_ms = 1000;
+    int once = 0;
+    char name_buf[256];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval_ms = atoi(argv[++i]);
+            if (interval_ms < 50) interval_ms = 50;
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = 1;
+        } else if (argv[i][0] != '-') {
+            name = argv[i];
+        } else {
+            printf("Usage: wm_top [/name] [--interval MS] [--once]\n");
+            return 2;
+        }
+    }
+    if (name[0] != '/') {
+        snprintf(name_buf, sizeof(name_buf), "/%.250s", name);
+        name = name_buf;
+    }
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        printf("Nothing to watch at %s. Start run_batch with RUN_BATCH_LIVE set first.\n", name);
+        return 2;
+    }
+    void *mem = mmap(NULL, sizeof(LiveHeader), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return 2;
+    }
+    const LiveHeader *h = (const LiveHeader *)mem;
+
+    // run_batch writes the magic last; give it a moment if we were very quick
+    for (int tries = 0; memcmp(h->magic, LIVE_MAGIC, 4) != 0 && tries < 20; tries++) {
+        usleep(50000);
+    }
+    if (memcmp(h->magic, LIVE_MAGIC, 4) != 0 || h->version != LIVE_VERSION) {
+        printf("ERROR: %s isn't run_batch live state (or a different version)\n", name);
+        munmap(mem, sizeof(LiveHeader));
+        return 2;
+    }
+
+    static LiveWorker now[LIVE_MAX_WORKERS];
+    static LiveWorker last[LIVE_MAX_WORKERS];
+    for (int w = 0; w < h->workers; w++) {
+        read_worker(&h->worker[w], &last[w]);
+    }
+    uint64_t last_ns = now_ns();
+
+    for (;;) {
+        // --once still waits a little, otherwise there's no commands/sec to show
+        usleep(once ? 200000 : interval_ms * 1000);
+        int finished = __atomic_load_n(&h->finished, __ATOMIC_ACQUIRE);
+
+        uint64_t t = now_ns();
+        for (int w = 0; w < h->workers; w++) {
+            read_worker(&h->worker[w], &now[w]);
+        }
+        print_screen(h, now, last, (t - last_ns) / 1e9, !once);
+
+        if (once || finished) break;
+        memcpy(last, now, sizeof(now));
+        last_ns = t;
+    }
+
+    munmap(mem, sizeof(LiveHeader));
+    return 0;
+}
+#endif